@@ -0,0 +1,238 @@
+/**
+ * Microbenchmarks for the hot paths of docgen.
+ * Every benchmark runs a fixed input through one function, see bench.hpp for how it is timed.
+ * Usage: docgen_bench [--filter <substring>] [--min-time <seconds>] [--repetitions <n>] [--json <output file>]
+ */
+
+#include "bench.hpp"
+#include "../docgen.hpp"
+
+#ifndef DOCGEN_BENCH_DOCS
+#define DOCGEN_BENCH_DOCS "bench_docs"
+#endif
+
+// a source file that looks like a typical documented header: license block, line comments, doc comments and code
+std::string make_source(size_t functions) {
+    std::string src = "/*\n * Copyright (c) docgen benchmarks\n * Licensed under whatever license you like.\n */\n";
+    src += "#include <string>\n#include <vector>\n\n";
+    for (size_t i = 0; i < functions; i++) {
+        std::string n = std::to_string(i);
+        src += "// helper number " + n + ", not documented\n";
+        src += "static int helper" + n + "(int x) { return x * " + n + "; } // trailing comment\n\n";
+        src += "/*@DOC\n@SECTION(Functions)\n#### `@FUNC_NAME`\n```cpp\n@S_NEXT_DECL\n```\n";
+        src += "Computes something useful for item " + n + ".\nIt takes @S_FUNC_ARGS and returns @S_FUNC_RET.\n*/\n";
+        src += "long long int function" + n + "(int a, const std::vector<std::string>& names, float b = 1.0f) {\n";
+        src += "    // sum things up\n    long long int total = a;\n    for (const auto& s : names) total += s.size();\n";
+        src += "    return total + (long long int) b;\n}\n\n";
+    }
+    return src;
+}
+
+// a source file with plenty of comments, none of which are documentation
+std::string make_plain_source(size_t functions) {
+    std::string src;
+    for (size_t i = 0; i < functions; i++) {
+        std::string n = std::to_string(i);
+        src += "/* block comment " + n + " explaining the next function in some detail,\n   over multiple lines */\n";
+        src += "int plain" + n + "(int a, int b) {\n    // add them\n    return a + b; // done\n}\n\n";
+    }
+    return src;
+}
+
+// a generated header: long stretches of code with the occasional '/' operator and hardly any comments
+std::string make_generated_source(size_t tables) {
+    std::string src = "// generated file, do not edit\n#pragma once\n\n";
+    for (size_t i = 0; i < tables; i++) {
+        std::string n = std::to_string(i);
+        src += "static const int table" + n + "[] = {\n";
+        for (size_t row = 0; row < 16; row++) {
+            src += "    0x1f, 0x2e, 0x3d, 0x4c, 0x5b, 0x6a, 0x79, 0x88, 0x97, 0xa6, 0xb5, 0xc4, 0xd3, 0xe2, 0xf1, 0x00,\n";
+        }
+        src += "};\nstatic const int scaled" + n + " = sizeof(table" + n + ") / sizeof(table" + n + "[0]);\n\n";
+    }
+    return src;
+}
+
+// a Python module with docstrings, # comments and strings
+std::string make_python_source(size_t functions) {
+    std::string src = "# Copyright (c) docgen benchmarks\nimport os\n\n";
+    for (size_t i = 0; i < functions; i++) {
+        std::string n = std::to_string(i);
+        src += "# helper number " + n + ", not documented\n";
+        src += "def function" + n + "(a, names, b=1.0):\n";
+        src += "    \"\"\"@DOC\n    @SECTION(Functions)\n    Computes something useful for item " + n + ".\n    \"\"\"\n";
+        src += "    total = a  # start\n    for s in names:\n        total += len(s) + len('#' + \"x\")\n";
+        src += "    return total + b\n\n";
+    }
+    return src;
+}
+
+// doc comments over code with no ';', '{', '=' or '}', so nothing ends their declarations but the next doc comment
+std::string make_undeclared_source(size_t comments) {
+    std::string src;
+    for (size_t i = 0; i < comments; i++) {
+        src += "//@DOC @FUNC_NAME @FUNC_RET\nalpha beta gamma " + std::to_string(i) + "\n";
+    }
+    return src;
+}
+
+// builds the comment data for a doc comment at the start of src, the same way process_source does
+CommentData leading_comment(const std::string& src) {
+    size_t end = src.find("*/");
+    size_t textBegin = 2;
+    while (std::isspace((unsigned char) src[textBegin])) textBegin++;
+    size_t textEnd = end;
+    while (textEnd > textBegin && std::isspace((unsigned char) src[textEnd-1])) textEnd--;
+    return {0, end + 2, textBegin, textEnd};
+}
+
+int main(int argc, char** argv) {
+    if (!parse_bench_args(argc, argv, "docgen_bench")) {
+        return 1;
+    }
+
+    DocContext context;
+    context.outputDir = DOCGEN_BENCH_DOCS;
+    context.aliases["FUNCTION"] = "#### `@FUNC_NAME` returns `@S_FUNC_RET` with args `@S_FUNC_ARGS`:\n```cpp\n@S_NEXT_DECL\n```";
+    // every op starts from empty output, so the sections don't grow without bound
+    auto reset = [&context]() {
+        context.mainSection.clear();
+        context.sections.clear();
+        context.currentSection.clear();
+        context.symbols = SymbolTable();
+    };
+
+    // process_source
+    const std::string docSource = make_source(200);
+    run_bench("process_source/doc", docSource.size(), [&]() {
+        reset();
+        process_source(docSource, context, "bench.cpp");
+    });
+    const std::string plainSource = make_plain_source(400);
+    run_bench("process_source/plain", plainSource.size(), [&]() {
+        reset();
+        process_source(plainSource, context, "bench.cpp");
+    });
+    const std::string undeclaredSource = make_undeclared_source(2000);
+    run_bench("process_source/undeclared", undeclaredSource.size(), [&]() {
+        reset();
+        process_source(undeclaredSource, context, "bench.cpp");
+    });
+    const std::string generatedSource = make_generated_source(100);
+    run_bench("process_source/generated", generatedSource.size(), [&]() {
+        reset();
+        process_source(generatedSource, context, "bench.cpp");
+    });
+
+    // the lexer on its own
+    run_bench("lex_source/doc", docSource.size(), [&]() {
+        TokenTable tokens = lex_source(docSource);
+        do_not_optimize(tokens);
+    });
+    run_bench("lex_source/generated", generatedSource.size(), [&]() {
+        TokenTable tokens = lex_source(generatedSource);
+        do_not_optimize(tokens);
+    });
+    const std::string pythonSource = make_python_source(200);
+    run_bench("lex_source/python", pythonSource.size(), [&]() {
+        TokenTable tokens = lex_source(pythonSource, Language::Python);
+        do_not_optimize(tokens);
+    });
+
+    // helpers
+    const std::string argList = "(\"a quoted, string\", (nested, parens), [bracket, list], {brace, list}, plain words)";
+    run_bench("parse_args", argList.size(), [&]() {
+        size_t index = 0;
+        ArgList args = parse_args(argList, index);
+        do_not_optimize(args);
+    });
+    const std::string codeArgList = "(const std::map<std::string, int>& counts, char separator = ',', std::pair<int, int> range = {0, 1'000})";
+    run_bench("parse_args/code", codeArgList.size(), [&]() {
+        size_t index = 0;
+        ArgList args = parse_args(codeArgList, index, nullptr, ArgSyntax::Code);
+        do_not_optimize(args);
+    });
+    const std::string spaced = "  long long   int\n    function(int   a,\n\t\tconst std::vector<std::string>&   names,\n    float b = 1.0f)  ";
+    run_bench("simplify_whitespace", spaced.size(), [&]() {
+        std::string s = simplify_whitespace(spaced);
+        do_not_optimize(s);
+    });
+    std::string markdown;
+    for (int i = 0; i < 200; i++) {
+        markdown += "#### `function" + std::to_string(i) + "`\n\n  \n\t\nSome prose about it.\n\n\n";
+    }
+    run_bench("simplify_md", markdown.size(), [&]() {
+        std::string s = simplify_md(markdown);
+        do_not_optimize(s);
+    });
+
+    // every branch of process_src_command
+    const std::string funcSrc = "/*@DOC\n@FUNCTION\n*/\nlong long int sampleFunction(int a, const std::vector<std::string>& names, float b) {\n    return a + b;\n}\n";
+    const std::string classSrc = "/*@DOC\n@CLASS_NAME\n*/\nclass SampleClass : public Base {\npublic:\n    int x;\n    SampleClass(int x) : x(x) {}\n"
+                                 "    int get() const { return x; }\nprivate:\n    void reset();\n};\n";
+    const std::string macroSrc = "/*@DOC\n@NEXT_MACRO\n*/\n#define SAMPLE_MACRO(a, b, ...) ((a) + (b))\n";
+    const CommentData funcComment = leading_comment(funcSrc);
+    const CommentData classComment = leading_comment(classSrc);
+    const CommentData macroComment = leading_comment(macroSrc);
+    SourceFile funcFile(funcSrc, "src/bench.cpp", lex_source(funcSrc));
+    SourceFile classFile(classSrc, "src/bench.cpp", lex_source(classSrc));
+    SourceFile macroFile(macroSrc, "src/bench.cpp", lex_source(macroSrc));
+    struct CommandCase {
+        std::string name;
+        ArgList args;
+        const std::string& src;
+        const CommentData& comment;
+        SourceFile& file;
+    };
+    std::vector<CommandCase> cases = {
+            {"SECTION", {"Functions"}, funcSrc, funcComment, funcFile},
+            {"NEXT_LINE", {}, funcSrc, funcComment, funcFile},
+            {"NEXT_LINES", {"2"}, funcSrc, funcComment, funcFile},
+            {"LINE_NUMBER", {}, funcSrc, funcComment, funcFile},
+            {"FUNC_NAME", {}, funcSrc, funcComment, funcFile},
+            {"NEXT_DECL", {}, funcSrc, funcComment, funcFile},
+            {"S_NEXT_DECL", {}, funcSrc, funcComment, funcFile},
+            {"FUNC_RET", {}, funcSrc, funcComment, funcFile},
+            {"FUNC_ARGS", {}, funcSrc, funcComment, funcFile},
+            {"FUNC_ARG", {"1"}, funcSrc, funcComment, funcFile},
+            {"CLASS_NAME", {}, classSrc, classComment, classFile},
+            {"CLASS_BASES", {}, classSrc, classComment, classFile},
+            {"CLASS_MEMBERS", {}, classSrc, classComment, classFile},
+            {"NEXT_MACRO", {}, macroSrc, macroComment, macroFile},
+            {"REF", {"SampleClass::get", "get"}, classSrc, classComment, classFile},
+            {"FILE_NAME", {}, funcSrc, funcComment, funcFile},
+            {"SIMPLIFY", {"FUNC_ARGS"}, funcSrc, funcComment, funcFile},
+            {"FUNCTION", {}, funcSrc, funcComment, funcFile},
+    };
+    if (fs::exists(context.outputDir / "commands" / "BENCH_CMD.so")) {
+        cases.push_back({"BENCH_CMD", {"result"}, funcSrc, funcComment, funcFile});
+    } else {
+        std::cerr << "Skipping plugin benchmark, " << (context.outputDir / "commands" / "BENCH_CMD.so") << " not found\n";
+    }
+    // the declaration after the comment is parsed again on every op, like for the first command of each doc comment
+    for (const CommandCase& c : cases) {
+        run_bench("process_src_command/" + c.name, c.src.size() - c.comment.end_index, [&]() {
+            reset();
+            c.file.declarationsOf = std::string_view::npos;
+            process_src_command(c.name, c.args, context, c.comment, c.src, c.file, c.comment.index, false);
+        });
+    }
+    // and the commands that read it once more with it cached, like every later command of the comment
+    // (not CLASS_MEMBERS, whose members replace the declaration every time)
+    const std::vector<std::string> declarationCommands = {"FUNC_NAME", "NEXT_DECL", "FUNC_RET", "FUNC_ARGS", "FUNC_ARG",
+                                                          "CLASS_NAME", "CLASS_BASES", "NEXT_MACRO"};
+    for (const CommandCase& c : cases) {
+        if (std::find(declarationCommands.begin(), declarationCommands.end(), c.name) == declarationCommands.end()) {
+            continue;
+        }
+        run_bench("process_src_command/" + c.name + "/cached", c.src.size() - c.comment.end_index, [&]() {
+            reset();
+            process_src_command(c.name, c.args, context, c.comment, c.src, c.file, c.comment.index, false);
+        });
+    }
+
+    if (!options.jsonPath.empty()) {
+        write_json(options.jsonPath);
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Benchmark harness shared by docgen_bench and docgen_glob_bench.
+// Every benchmark runs one function until at least --min-time seconds have passed, repeats that --repetitions times,
+// and reports ns/op, MB/s or items/s, and heap allocations per op of the fastest run.
+// Each benchmark executable is a single translation unit that includes this header, so it also installs
+// the counting operator new.
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#define DOCGEN_ALLOC_HOOKS // count allocations, for allocs/op
+#include "../memstats.hpp"
+
+struct BenchOptions {
+    std::string filter;
+    double minTime = 0.2;
+    size_t repetitions = 3;
+    std::string jsonPath;
+};
+
+struct BenchResult {
+    std::string name;
+    size_t iterations;
+    double nsPerOp;
+    double bytesPerSec;
+    double itemsPerSec;
+    double allocsPerOp;
+    std::vector<std::pair<std::string, double>> extra; // benchmark specific numbers, written to the JSON as well
+};
+
+static BenchOptions options;
+static std::vector<BenchResult> results;
+
+// keeps the optimizer from throwing away a result
+template <typename T>
+void do_not_optimize(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+// parses the common options, prints usage and returns false if they are wrong
+bool parse_bench_args(int argc, char** argv, const char* program) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            options.minTime = std::stod(argv[++i]);
+        } else if (arg == "--repetitions" && i + 1 < argc) {
+            options.repetitions = std::stoul(argv[++i]);
+        } else if (arg == "--json" && i + 1 < argc) {
+            options.jsonPath = argv[++i];
+        } else {
+            std::cerr << "Usage: " << program << " [--filter <substring>] [--min-time <seconds>] [--repetitions <n>] [--json <output file>]\n";
+            return false;
+        }
+    }
+    allocCounters.enabled = true;
+    std::cout << std::left << std::setw(48) << "benchmark" << std::right << std::setw(12) << "iterations"
+              << std::setw(14) << "ns/op" << std::setw(12) << "MB/s" << std::setw(14) << "items/s" << std::setw(12) << "allocs/op" << '\n';
+    return true;
+}
+
+// returns the result, or nullptr if the benchmark was filtered out; the pointer is valid until the next run_bench
+template <typename F>
+BenchResult* run_bench(const std::string& name, size_t bytesPerOp, size_t itemsPerOp, F&& f) {
+    if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+        return nullptr;
+    }
+    using clock = std::chrono::steady_clock;
+    // warm up, and make sure the first timed batch doesn't pay for lazy initialization
+    f();
+    size_t iterations = 1;
+    size_t repetition = 0;
+    double best = 0;
+    while (true) {
+        size_t allocsBefore = allocCounters.count.load(std::memory_order_relaxed);
+        auto start = clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            f();
+        }
+        double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        size_t allocs = allocCounters.count.load(std::memory_order_relaxed) - allocsBefore;
+        if (elapsed >= options.minTime || iterations >= (size_t(1) << 30) || repetition > 0) {
+            // the batch size is settled, keep the fastest of the repetitions
+            if (repetition == 0 || elapsed < best) {
+                best = elapsed;
+            }
+            if (++repetition < options.repetitions) {
+                continue;
+            }
+            elapsed = best;
+            BenchResult r;
+            r.name = name;
+            r.iterations = iterations;
+            r.nsPerOp = elapsed * 1e9 / iterations;
+            r.bytesPerSec = elapsed > 0 ? bytesPerOp * iterations / elapsed : 0;
+            r.itemsPerSec = elapsed > 0 ? itemsPerOp * iterations / elapsed : 0;
+            r.allocsPerOp = (double) allocs / iterations;
+            std::cout << std::left << std::setw(48) << r.name << std::right
+                      << std::setw(12) << r.iterations
+                      << std::setw(14) << std::fixed << std::setprecision(1) << r.nsPerOp
+                      << std::setw(12) << std::setprecision(2) << r.bytesPerSec / 1e6
+                      << std::setw(14) << std::setprecision(0) << r.itemsPerSec
+                      << std::setw(12) << std::setprecision(2) << r.allocsPerOp << '\n';
+            results.push_back(r);
+            return &results.back();
+        }
+        // aim for the minimum time in the next batch, but never grow more than 10x at once
+        double scale = elapsed > 0 ? options.minTime * 1.2 / elapsed : 10.0;
+        if (scale > 10.0) scale = 10.0;
+        if (scale < 2.0) scale = 2.0;
+        iterations = (size_t)(iterations * scale);
+    }
+}
+
+template <typename F>
+BenchResult* run_bench(const std::string& name, size_t bytesPerOp, F&& f) {
+    return run_bench(name, bytesPerOp, 0, std::forward<F>(f));
+}
+
+void write_json(const std::string& path) {
+    std::ofstream out(path);
+    out << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+            << ", \"ns_per_op\": " << std::setprecision(3) << std::fixed << r.nsPerOp
+            << ", \"bytes_per_second\": " << r.bytesPerSec;
+        if (r.itemsPerSec > 0) {
+            out << ", \"items_per_second\": " << r.itemsPerSec;
+        }
+        out << ", \"allocs_per_op\": " << r.allocsPerOp;
+        for (const auto& [key, value] : r.extra) {
+            out << ", \"" << key << "\": " << value;
+        }
+        out << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
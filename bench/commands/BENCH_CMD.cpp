@@ -0,0 +1,11 @@
+// Plugin command used by docgen_bench to measure the cost of the plugin branch of process_src_command.
+// Built by CMake into bench_docs/commands/BENCH_CMD.so, the same layout NEW_COMMAND produces.
+#include <string>
+#include <vector>
+
+std::string BENCH_CMD(const std::string &, const std::vector<std::string> &args) {
+    if (args.empty()) {
+        return "bench";
+    }
+    return args[0];
+}
@@ -0,0 +1,141 @@
+/**
+ * Benchmarks for glob.hpp over synthetic directory trees.
+ * Trees vary in depth, fan-out and the share of hidden directories, and each is globbed with several pattern shapes.
+ * Besides entries/s, every rglob run reports how its time splits between regex work (fnmatch and is_hidden,
+ * which compile a std::regex per call) and directory listing, using the GLOB_STATS counters of glob.hpp.
+ * Usage: docgen_glob_bench [--filter <substring>] [--min-time <seconds>] [--repetitions <n>] [--json <output file>]
+ */
+
+#include "bench.hpp"
+#define GLOB_STATS
+#include "../glob.hpp"
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+struct TreeShape {
+    std::string name;
+    size_t depth;
+    size_t fanout;
+    double hiddenRatio;
+    size_t filesPerDir;
+};
+
+// files named <letter><n>.<ext>, cycling through the letters a-f and the extensions cpp, hpp and txt
+void make_files(const fs::path& dir, size_t count) {
+    static const char* extensions[] = {".cpp", ".hpp", ".txt"};
+    for (size_t i = 0; i < count; i++) {
+        std::string name = std::string(1, (char) ('a' + i % 6)) + std::to_string(i) + extensions[i % 3];
+        std::ofstream(dir / name) << "// " << name << '\n';
+    }
+}
+
+void make_tree(const fs::path& dir, const TreeShape& shape, size_t level) {
+    fs::create_directories(dir);
+    make_files(dir, shape.filesPerDir);
+    if (level == shape.depth) {
+        return;
+    }
+    for (size_t i = 0; i < shape.fanout; i++) {
+        // spread the hidden directories evenly
+        bool hidden = (size_t) (i * shape.hiddenRatio) != (size_t) ((i + 1) * shape.hiddenRatio);
+        make_tree(dir / ((hidden ? ".d" : "d") + std::to_string(i)), shape, level + 1);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (!parse_bench_args(argc, argv, "docgen_glob_bench")) {
+        return 1;
+    }
+
+    const std::vector<std::string> patterns = {"*.cpp", "src/**/*.hpp", "src/*/[a-c]*.cpp", "src/**/*.[ch]pp"};
+    const std::vector<TreeShape> shapes = {
+            {"d2_f4", 2, 4, 0, 6},
+            {"d3_f6", 3, 6, 0, 6},
+            {"d3_f6_hidden25", 3, 6, 0.25, 6},
+            {"d5_f3", 5, 3, 0, 6},
+    };
+
+    // regex costs on their own
+    for (const std::string& pattern : patterns) {
+        run_bench("glob/compile/" + pattern, pattern.size(), 1, [&]() {
+            std::regex re = glob::compile_pattern(pattern);
+            do_not_optimize(re);
+        });
+    }
+    for (const std::string& pattern : patterns) {
+        const fs::path name = "b1.hpp";
+        run_bench("glob/fnmatch/" + pattern, pattern.size(), 1, [&]() {
+            bool match = glob::fnmatch(name, fs::path(pattern).filename().string());
+            do_not_optimize(match);
+        });
+    }
+    const std::string hiddenPath = "src/d1/.d2";
+    run_bench("glob/is_hidden", hiddenPath.size(), 1, [&]() {
+        bool hidden = glob::is_hidden(hiddenPath);
+        do_not_optimize(hidden);
+    });
+
+    fs::path oldCwd = fs::current_path();
+    fs::path root = fs::temp_directory_path() / ("docgen_glob_bench_" + std::to_string(getpid()));
+    for (const TreeShape& shape : shapes) {
+        fs::remove_all(root);
+        fs::create_directories(root);
+        make_files(root, shape.filesPerDir);
+        make_tree(root / "src", shape, 0);
+        fs::current_path(root);
+
+        // directory iteration alone, as a floor for what globbing could cost
+        size_t treeEntries = 0;
+        for (auto it = fs::recursive_directory_iterator("src"); it != fs::recursive_directory_iterator(); ++it) {
+            treeEntries++;
+        }
+        run_bench("glob/iterate/" + shape.name, 0, treeEntries, [&]() {
+            size_t n = 0;
+            for (auto it = fs::recursive_directory_iterator("src"); it != fs::recursive_directory_iterator(); ++it) {
+                n++;
+            }
+            do_not_optimize(n);
+        });
+
+        for (const std::string& pattern : patterns) {
+            glob::stats = {};
+            size_t matches = glob::rglob(pattern).size();
+            size_t entries = glob::stats.entries;
+            glob::stats = {};
+            double total = 0;
+            BenchResult* r = run_bench("glob/rglob/" + shape.name + "/" + pattern, 0, entries, [&]() {
+                auto start = std::chrono::steady_clock::now();
+                std::vector<fs::path> found = glob::rglob(pattern);
+                total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                do_not_optimize(found);
+            });
+            if (!r) {
+                continue;
+            }
+            double regex = glob::stats.matchSeconds + glob::stats.hiddenSeconds;
+            double regexPercent = total > 0 ? regex * 100 / total : 0;
+            double compilePercent = total > 0 ? (glob::stats.compileSeconds + glob::stats.hiddenSeconds) * 100 / total : 0;
+            // fnmatch and is_hidden run inside iter_directory's callers, not inside it, so listing doesn't overlap regex
+            double listingPercent = total > 0 ? glob::stats.listingSeconds * 100 / total : 0;
+            r->extra = {{"matches", (double) matches}, {"entries", (double) entries}, {"regex_percent", regexPercent},
+                        {"regex_compile_percent", compilePercent}, {"listing_percent", listingPercent}};
+            std::cout << std::left << std::setw(48) << "" << std::setprecision(1) << "  " << matches << " matches, "
+                      << entries << " entries, regex " << regexPercent << "% (compile " << compilePercent
+                      << "%), listing " << listingPercent << "%\n";
+        }
+        fs::current_path(oldCwd);
+    }
+    fs::remove_all(root);
+
+    if (!options.jsonPath.empty()) {
+        write_json(options.jsonPath);
+    }
+    return 0;
+}
@@ -0,0 +1,541 @@
+// Parser for the C++ declaration after a doc comment, behind FUNC_NAME, FUNC_RET, FUNC_ARGS, NEXT_DECL and CLASS_NAME.
+// It works on a light token stream (identifiers, literals and punctuation, with comments and preprocessor lines
+// skipped) in one linear pass, and understands just enough of the grammar to find the parts of a declaration:
+// template<...> headers, [[attributes]] and __attribute__((...)), specifiers like static or virtual, qualified and
+// operator names, parameter lists with default arguments and nested parentheses, cv and ref qualifiers, noexcept,
+// trailing return types, = default / = 0, and class heads with their base lists.
+// Everything is reported as offsets into the source; nothing is copied.
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include "lexer.hpp"
+
+enum class DeclKind : uint8_t {
+    Function,
+    Class, // also struct, union and enum
+    Macro,
+    Other
+};
+
+enum class ClassKey : uint8_t {
+    Class,
+    Struct,
+    Union,
+    Enum
+};
+
+enum class Access : uint8_t {
+    Public,
+    Protected,
+    Private
+};
+
+struct ParsedDeclaration {
+    static constexpr size_t none = std::string_view::npos;
+
+    DeclKind kind = DeclKind::Other;
+    size_t end = 0; // where the declaration stops: its body, initializer, ';', or a constructor's initializer list
+    size_t typeBegin = none; // the type, or return type, of what is declared
+    size_t typeEnd = none;
+    size_t nameBegin = none; // its unqualified name, like "bar", "~Foo" or "operator()"
+    size_t nameEnd = none;
+    size_t scopeBegin = none; // the class or namespace the name is qualified with, like "Foo" in Foo::bar
+    size_t scopeEnd = none;
+    size_t paramsBegin = none; // the parameter list without its parentheses, for functions
+    size_t paramsEnd = none;
+    ClassKey key = ClassKey::Class; // for classes
+    size_t basesBegin = none; // the base list after the ':', for classes
+    size_t basesEnd = none;
+};
+
+// a declaration in a class body, or an enumerator
+struct ClassMember {
+    Access access;
+    size_t begin; // its first token, after the comments before it
+    size_t end; // just after its last token
+};
+
+namespace decl_detail {
+
+    // 'a' for identifiers and numbers, '"' for string and character literals, the character itself for punctuation
+    // ("::" and "->" are one token each), '\0' at the end
+    struct DeclToken {
+        size_t begin;
+        size_t end;
+        char kind;
+
+        bool is(char c) const {
+            return kind == c && end - begin == 1;
+        }
+    };
+
+    class DeclScanner {
+    public:
+        DeclScanner(std::string_view src, size_t pos) : src(src), pos(pos) {}
+
+        DeclToken next() {
+            using namespace lexer_detail;
+            skip_space();
+            if (pos >= src.size()) {
+                return {src.size(), src.size(), '\0'};
+            }
+            size_t begin = pos;
+            char c = src[pos];
+            if (is_ident(c)) {
+                while (pos < src.size() && is_ident(src[pos])) pos++;
+                return {begin, pos, 'a'};
+            }
+            if (c == '"' || (c == '\'' && !digit_separator(src, pos))) {
+                pos = quoted_end(src, pos + 1, c);
+                return {begin, pos, '"'};
+            }
+            if (pos + 1 < src.size() && ((c == ':' && src[pos+1] == ':') || (c == '-' && src[pos+1] == '>'))) {
+                pos += 2;
+                return {begin, pos, c};
+            }
+            pos++;
+            return {begin, pos, c};
+        }
+
+        DeclToken peek() {
+            size_t saved = pos;
+            DeclToken t = next();
+            pos = saved;
+            return t;
+        }
+
+        std::string_view text(const DeclToken& t) const {
+            return src.substr(t.begin, t.end - t.begin);
+        }
+
+        // skips to the token closing a group whose opening token was just read, and returns that token
+        // inside <...>, parentheses are groups of their own so the '>' in (a > b) doesn't close it
+        DeclToken skip_group(char open, char close) {
+            int depth = 1;
+            int parens = 0;
+            while (true) {
+                DeclToken t = next();
+                if (t.kind == '\0') {
+                    return t;
+                }
+                if (open == '<' && t.is('(')) {
+                    parens++;
+                } else if (open == '<' && t.is(')') && parens > 0) {
+                    parens--;
+                } else if (parens == 0 && t.is(open)) {
+                    depth++;
+                } else if (parens == 0 && t.is(close) && --depth == 0) {
+                    return t;
+                }
+            }
+        }
+
+    private:
+        void skip_space() {
+            using namespace lexer_detail;
+            while (pos < src.size()) {
+                char c = src[pos];
+                if (is_space(c)) {
+                    pos++;
+                } else if (c == '/' && pos + 1 < src.size() && src[pos+1] == '/') {
+                    pos = line_end(src, pos);
+                } else if (c == '/' && pos + 1 < src.size() && src[pos+1] == '*') {
+                    size_t close = src.find("*/", pos + 2);
+                    pos = close == std::string_view::npos ? src.size() : close + 2;
+                } else if (c == '#' && at_line_start(src, pos)) {
+                    pos = line_end(src, pos);
+                } else {
+                    break;
+                }
+            }
+        }
+
+        std::string_view src;
+        size_t pos;
+    };
+
+    // words before the type that say nothing about it
+    inline bool is_specifier(std::string_view word) {
+        return word == "static" || word == "inline" || word == "virtual" || word == "explicit" || word == "extern" ||
+               word == "friend" || word == "constexpr" || word == "consteval" || word == "constinit" ||
+               word == "thread_local" || word == "mutable" || word == "register" || word == "typedef";
+    }
+
+    inline bool is_class_key(std::string_view word) {
+        return word == "class" || word == "struct" || word == "union" || word == "enum";
+    }
+
+    // words followed by a parenthesized group that isn't a parameter list
+    inline bool takes_group(std::string_view word) {
+        return word == "__attribute__" || word == "__declspec" || word == "alignas" || word == "_Alignas" ||
+               word == "decltype" || word == "noexcept" || word == "throw";
+    }
+
+    // true if the parentheses whose '(' was just read hold a declarator, like (*f), (&r) or (Foo::*member), rather than
+    // parameters
+    inline bool opens_declarator(DeclScanner in) {
+        DeclToken t = in.next();
+        while (t.kind == 'a' && in.peek().kind == ':' && in.peek().end - in.peek().begin == 2) {
+            in.next();
+            t = in.next();
+        }
+        return t.is('*') || t.is('&') || t.is('^');
+    }
+
+} // namespace decl_detail
+
+// reads a class head after its class key, up to the '{' or ';' that ends it, and returns true if it is one
+// for something like struct Foo* make() it returns false with t on the first token that doesn't fit a class head
+inline bool parse_class_head(decl_detail::DeclScanner& in, ParsedDeclaration& d, decl_detail::DeclToken& t) {
+    using namespace decl_detail;
+    std::string_view key = in.text(t);
+    d.key = key == "struct" ? ClassKey::Struct : key == "union" ? ClassKey::Union : key == "enum" ? ClassKey::Enum : ClassKey::Class;
+    while (true) {
+        t = in.next();
+        std::string_view word = t.kind == 'a' ? in.text(t) : std::string_view();
+        if (t.is('[') && in.peek().is('[')) {
+            in.skip_group('[', ']');
+        } else if (takes_group(word) && in.peek().is('(')) {
+            in.next();
+            in.skip_group('(', ')');
+        } else if (t.kind == 'a' && word != "final") {
+            // the last identifier is the name, so export macros and "enum class" are skipped over
+            d.nameBegin = t.begin;
+            d.nameEnd = t.end;
+        } else if (t.is('<')) {
+            in.skip_group('<', '>');
+        } else if (t.is(':') || t.is('{') || t.is(';')) {
+            // the base list belongs to the declaration
+            size_t colon = t.is(':') ? t.end : ParsedDeclaration::none;
+            while (t.kind != '\0' && !t.is('{') && !t.is(';') && !t.is('}')) {
+                if (t.is('<') || t.is('(')) {
+                    in.skip_group(t.kind, t.is('<') ? '>' : ')');
+                }
+                t = in.next();
+            }
+            if (colon != ParsedDeclaration::none) {
+                d.basesBegin = colon;
+                d.basesEnd = t.begin;
+            }
+            d.kind = DeclKind::Class;
+            d.end = t.begin;
+            return true;
+        } else if (t.kind != ':' && t.kind != 'a') {
+            return false;
+        }
+    }
+}
+
+// reads a parenthesized declarator whose '(' was just read, up to its ')', and records the name in it along with the
+// parameter list right after the name, if there is one
+inline void parse_nested_declarator(decl_detail::DeclScanner& in, ParsedDeclaration& d) {
+    using namespace decl_detail;
+    const size_t none = ParsedDeclaration::none;
+    bool afterName = false;
+    bool afterScope = false;
+    for (int depth = 1; depth > 0; ) {
+        DeclToken t = in.next();
+        std::string_view word = t.kind == 'a' ? in.text(t) : std::string_view();
+        if (t.kind == '\0') {
+            return;
+        }
+        if (t.is('(') && afterName && d.kind != DeclKind::Function) {
+            d.paramsBegin = t.end;
+            d.paramsEnd = in.skip_group('(', ')').begin;
+            d.kind = DeclKind::Function;
+        } else if (t.is('(')) {
+            depth++;
+        } else if (t.is(')')) {
+            depth--;
+        } else if (t.is('[') || t.is('<')) {
+            in.skip_group(t.kind, t.is('[') ? ']' : '>');
+        } else if (t.kind == ':' && t.end - t.begin == 2) {
+            afterScope = true;
+            afterName = false;
+            continue;
+        } else if (t.kind == 'a' && word != "const" && word != "volatile" && d.kind != DeclKind::Function) {
+            if (afterScope && d.nameBegin != none) {
+                d.scopeBegin = d.nameBegin;
+                d.scopeEnd = d.nameEnd;
+            } else if (!afterScope) {
+                d.scopeBegin = d.scopeEnd = none;
+            }
+            d.nameBegin = t.begin;
+            d.nameEnd = t.end;
+            afterName = true;
+            afterScope = false;
+            continue;
+        }
+        afterName = false;
+        afterScope = false;
+    }
+}
+
+// parses the declaration starting at pos; it ends at a top-level ';', '{', '=' or '}', or the end of src at the latest
+inline ParsedDeclaration parse_declaration(std::string_view src, size_t pos) {
+    using namespace decl_detail;
+    const size_t none = ParsedDeclaration::none;
+    ParsedDeclaration d;
+    DeclScanner in(src, pos);
+    DeclToken t = in.next();
+    // template<...> headers
+    while (t.kind == 'a' && in.text(t) == "template") {
+        t = in.next();
+        if (t.is('<')) {
+            in.skip_group('<', '>');
+            t = in.next();
+        }
+    }
+
+    size_t chainBegin = none; // where the qualified name the name belongs to starts, like "std::" in std::string
+    bool afterName = false; // the previous token ended a name, so a '(' opens its parameters
+    bool afterScope = false; // the previous token was "::"
+    bool params = false; // the parameter list has been read
+    auto set_name = [&](size_t begin, size_t end) {
+        if (!afterScope) {
+            chainBegin = begin;
+            d.scopeBegin = d.scopeEnd = none;
+        } else if (d.nameBegin != none) {
+            d.scopeBegin = d.nameBegin;
+            d.scopeEnd = d.nameEnd;
+        }
+        d.nameBegin = begin;
+        d.nameEnd = end;
+        afterName = true;
+        afterScope = false;
+    };
+    // t is the token to look at next; a branch that has read one token too many leaves it there
+    for (bool reuse = true; ; ) {
+        if (!reuse) {
+            t = in.next();
+        }
+        reuse = false;
+        if (t.kind == '\0') {
+            d.end = src.size();
+            break;
+        }
+        std::string_view word = t.kind == 'a' ? in.text(t) : std::string_view();
+        if (t.is('[') && in.peek().is('[')) {
+            // [[attribute]]
+            in.skip_group('[', ']');
+            continue;
+        }
+        if (takes_group(word) && in.peek().is('(')) {
+            in.next();
+            in.skip_group('(', ')');
+            continue;
+        }
+        if (t.is(';') || t.is('{') || t.is('=') || t.is('}')) {
+            // a '}' closes the scope the comment is in, so nothing was declared after it
+            d.end = t.begin;
+            break;
+        }
+        if (params) {
+            // after the parameters: cv and ref qualifiers, noexcept and the like, a trailing return type,
+            // or a constructor's initializer list
+            if (t.is(':') || word == "try") {
+                d.end = t.begin;
+                break;
+            }
+            if (t.kind == '-' && t.end - t.begin == 2) {
+                DeclToken first = in.next();
+                size_t typeEnd = first.begin;
+                for (t = first; t.kind != '\0' && !t.is(';') && !t.is('{') && !t.is('=') && !t.is('}'); t = in.next()) {
+                    std::string_view w = t.kind == 'a' ? in.text(t) : std::string_view();
+                    if (w == "override" || w == "final" || w == "requires" || w == "try") {
+                        break;
+                    }
+                    if (t.is('<') || t.is('(')) {
+                        t = in.skip_group(t.kind, t.is('<') ? '>' : ')');
+                    }
+                    typeEnd = t.end;
+                }
+                d.typeBegin = first.begin;
+                d.typeEnd = typeEnd;
+                reuse = true;
+            }
+            continue;
+        }
+        if (t.kind == 'a' && d.typeBegin == none && is_specifier(word)) {
+            continue;
+        }
+        if (t.kind == 'a' && d.typeBegin == none && is_class_key(word)) {
+            d.typeBegin = t.begin;
+            size_t keyEnd = t.end;
+            if (parse_class_head(in, d, t)) {
+                d.typeBegin = d.typeEnd = keyEnd;
+                return d;
+            }
+            // part of the type, like struct Foo in struct Foo* make()
+            chainBegin = d.nameBegin;
+            afterName = d.nameBegin != none && t.is('(');
+            afterScope = false;
+            reuse = true;
+            continue;
+        }
+        if (d.typeBegin == none && t.kind != '"') {
+            d.typeBegin = t.begin;
+        }
+        if (word == "operator") {
+            // operator(), operator<<, operator new[], operator bool, operator""_x: everything up to the parameters
+            DeclToken last = t;
+            if (in.peek().is('(')) {
+                in.next();
+                last = in.next();
+            }
+            while (in.peek().kind != '\0' && !in.peek().is('(')) {
+                last = in.next();
+            }
+            set_name(t.begin, last.end);
+            continue;
+        }
+        if (t.is('~') && in.peek().kind == 'a') {
+            set_name(t.begin, in.next().end);
+            continue;
+        }
+        if (t.kind == 'a') {
+            set_name(t.begin, t.end);
+            continue;
+        }
+        if (t.kind == ':' && t.end - t.begin == 2) {
+            if (!afterName) chainBegin = t.begin;
+            afterScope = true;
+            afterName = false;
+            continue;
+        }
+        if (t.is('<') && afterName) {
+            // template arguments of the name, like std::vector<int> or a specialization foo<int>
+            in.skip_group('<', '>');
+            continue;
+        }
+        if (t.is('(')) {
+            bool declarator = opens_declarator(in);
+            if (afterName && !declarator) {
+                d.paramsBegin = t.end;
+                d.paramsEnd = in.skip_group('(', ')').begin;
+                d.kind = DeclKind::Function;
+                d.typeEnd = chainBegin;
+                params = true;
+            } else if (declarator) {
+                // a declarator in parentheses, like int (*callback)(int) or void (*signal(int, void (*)(int)))(int):
+                // the name is the innermost one, and a parameter list right after it makes it a function
+                parse_nested_declarator(in, d);
+                chainBegin = t.begin;
+                if (d.kind == DeclKind::Function) {
+                    d.typeEnd = t.begin;
+                    params = true;
+                }
+            } else {
+                // the parameters of a function pointer, like the (int) of int (*callback)(int)
+                in.skip_group('(', ')');
+            }
+            afterName = false;
+            continue;
+        }
+        afterName = false;
+        afterScope = false;
+    }
+    if (d.kind != DeclKind::Function) {
+        // the type is what comes before the name
+        d.typeEnd = chainBegin;
+    }
+    if (d.typeBegin == none || d.typeEnd == none || d.typeEnd < d.typeBegin) {
+        d.typeBegin = d.typeEnd = d.end;
+    }
+    return d;
+}
+
+// walks the body of a class whose '{' is at open once, and appends its members in order; returns where the body ends,
+// at its '}' or the end of src
+// access specifiers are followed along, nested classes and function bodies are skipped over, enumerators are split at ','
+// friend and using declarations are left out
+inline size_t parse_class_body(std::string_view src, size_t open, ClassKey key, std::vector<ClassMember>& members) {
+    using namespace decl_detail;
+    Access access = key == ClassKey::Class ? Access::Private : Access::Public;
+    DeclScanner in(src, open + 1);
+    while (true) {
+        DeclToken t = in.next();
+        if (t.kind == '\0' || t.is('}')) {
+            return t.begin;
+        }
+        std::string_view word = t.kind == 'a' ? in.text(t) : std::string_view();
+        if ((word == "public" || word == "protected" || word == "private") && in.peek().is(':')) {
+            in.next();
+            access = word == "public" ? Access::Public : word == "protected" ? Access::Protected : Access::Private;
+            continue;
+        }
+        if (t.is(';') || t.is(',')) {
+            continue;
+        }
+        if (key == ClassKey::Enum) {
+            // Red, Green = 2, Blue = Green << 1
+            DeclToken last = t;
+            for (DeclToken n = in.peek(); n.kind != '\0' && !n.is(',') && !n.is('}'); n = in.peek()) {
+                last = in.next();
+                if (last.is('(') || last.is('{')) {
+                    last = in.skip_group(last.kind, last.is('(') ? ')' : '}');
+                }
+            }
+            members.push_back({access, t.begin, last.end});
+            continue;
+        }
+        ParsedDeclaration d = parse_declaration(src, t.begin);
+        // friends aren't members, and using declarations and aliases only bring in names; they are stepped over
+        bool skip = false;
+        for (DeclScanner head(src, t.begin); !skip;) {
+            DeclToken h = head.next();
+            if (h.kind == '\0' || h.begin >= d.end) {
+                break;
+            }
+            std::string_view w = h.kind == 'a' ? head.text(h) : std::string_view();
+            skip = w == "friend" || w == "using";
+        }
+        // carry on from where the declaration stopped, and find where the member does
+        in = DeclScanner(src, d.end);
+        DeclToken stop = in.next();
+        size_t end = d.end;
+        if (stop.is(';')) {
+            end = stop.end;
+        } else if (stop.is('{') || stop.is(':') || stop.is('=') || (stop.kind == 'a' && in.text(stop) == "try")) {
+            // a body, maybe after a constructor's initializer list, or an initializer: up to the ';' or the body's '}'
+            bool initializer = stop.is('=');
+            DeclToken previous = stop;
+            for (DeclToken n = stop; n.kind != '\0'; previous = n, n = in.next()) {
+                if (n.is('(') || n.is('[')) {
+                    n = in.skip_group(n.kind, n.is('(') ? ')' : ']');
+                } else if (n.is('{')) {
+                    // braces right after a name are an initializer, like x{1} in an initializer list
+                    bool braceInit = initializer || (n.begin != stop.begin && (previous.kind == 'a' || previous.is('>')));
+                    n = in.skip_group('{', '}');
+                    end = n.end;
+                    if (!braceInit && d.kind != DeclKind::Class) {
+                        break;
+                    }
+                    continue;
+                } else if (n.is(';')) {
+                    end = n.end;
+                    break;
+                } else if (n.is('}')) {
+                    // the end of the class body, the member wasn't finished
+                    in = DeclScanner(src, n.begin);
+                    break;
+                }
+                end = n.end;
+            }
+            // a function body may be followed by a stray ';'
+            if (in.peek().is(';')) {
+                end = in.next().end;
+            }
+        } else if (stop.is('}')) {
+            // the last member without its ';'
+            in = DeclScanner(src, stop.begin);
+        }
+        if (!skip) {
+            members.push_back({access, t.begin, end});
+        }
+        if (stop.kind == '\0') {
+            return src.size();
+        }
+    }
+}
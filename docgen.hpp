@@ -0,0 +1,1244 @@
+// The doc generator itself, shared by main.cpp and the benchmarks.
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <filesystem>
+#include <deque>
+#include <fstream>
+#include <initializer_list>
+#include <unordered_map>
+#include <string_view>
+#include <vector>
+#include <regex>
+#include "glob.hpp"
+#include "profile.hpp"
+#include "trace.hpp"
+#include "stats.hpp"
+#include "perfcounters.hpp"
+#include "lexer.hpp"
+#include "declaration_parser.hpp"
+#include "line_index.hpp"
+#include "symbols.hpp"
+#include "mapped_file.hpp"
+
+// cross platform dynamic library loading
+#ifdef _WIN32
+#include <windows.h>
+#define LIB_HANDLE HINSTANCE
+#define LIB_LOAD(path) LoadLibrary(path)
+#define LIB_GET_FUNC(lib, name) GetProcAddress(lib, name)
+#define LIB_CLOSE(lib) FreeLibrary(lib)
+#define PATH_SEP "\\"
+#else
+#include <dlfcn.h>
+#define LIB_HANDLE void*
+#define LIB_LOAD(path) dlopen(path, RTLD_LAZY)
+#define LIB_GET_FUNC(lib, name) dlsym(lib, name)
+#define LIB_CLOSE(lib) dlclose(lib)
+#define PATH_SEP "/"
+#endif
+
+namespace fs = std::filesystem;
+
+struct DocContext {
+    std::unordered_map<std::string, std::string> sections;
+    std::string mainSection;
+    fs::path outputDir;
+    std::string inputDocgen;
+    std::string currentSection;
+    std::string output;
+    std::unordered_map<std::string, std::string> aliases;
+    Profiler* profiler = nullptr; // only set with --profile
+    Tracer* tracer = nullptr; // only set with --trace
+    CommandStats* stats = nullptr; // only set with --stats
+    MemoryStats* memory = nullptr; // only set with --mem
+    PerfCounters* perf = nullptr; // only set with --perf
+    size_t emittedBytes = 0; // everything written to the sections so far
+    size_t sourceBytes = 0; // everything read by PROCESS_SOURCES so far
+    size_t streamAbove = (size_t) -1; // files at least this big are streamed instead of mapped (--stream, --stream-above)
+    size_t streamWindow = 1 << 20; // bytes read at a time when streaming
+    size_t lookahead = 64 << 10; // how far after a doc comment its declaration is looked for, and all its commands see when streaming (--lookahead)
+    SymbolTable symbols; // every documented symbol, for @REF
+    std::string pendingAnchors; // anchor markers waiting for the first visible byte of their documentation
+    bool quiet = false;
+};
+
+struct CommentData {
+    size_t index;
+    size_t end_index;
+    size_t text_begin; // the comment text without markers and surrounding whitespace, as offsets into the source
+    size_t text_end;
+};
+
+// only comments containing @DOC can produce output, the rest are never copied or interpreted
+inline bool has_doc_marker(std::string_view text) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while ((p = simd::find_pair(p, end, '@', 'D')) != end) {
+        if (end - p >= 4 && p[2] == 'O' && p[3] == 'C') {
+            return true;
+        }
+        p++;
+    }
+    return false;
+}
+
+inline std::string_view strip(std::string_view s) {
+    // remove leading and trailing whitespace
+    size_t start = 0;
+    size_t end = s.size();
+    while (start < s.size() && std::isspace((unsigned char) s[start])) {
+        start++;
+    }
+    while (end > start && std::isspace((unsigned char) s[end-1])) {
+        end--;
+    }
+    return s.substr(start, end-start);
+}
+
+// appends s to out stripped, with every run of whitespace turned into a single space
+// no newlines or tabs or anything else
+inline void append_simplified(std::string_view s, std::string& out) {
+    s = strip(s);
+    size_t i = 0;
+    while (i < s.size()) {
+        if (std::isspace((unsigned char) s[i])) {
+            while (std::isspace((unsigned char) s[i])) {
+                i++;
+            }
+            out += ' ';
+        } else {
+            // copy the whole run up to the next whitespace at once
+            size_t start = i;
+            while (i < s.size() && !std::isspace((unsigned char) s[i])) {
+                i++;
+            }
+            out.append(s.data() + start, i - start);
+        }
+    }
+}
+
+inline std::string simplify_whitespace(std::string_view s) {
+    std::string out;
+    append_simplified(s, out);
+    return out;
+}
+
+// argument views with room for a few of them inline, so a typical command doesn't allocate
+class ArgList {
+public:
+    static constexpr size_t inlineCapacity = 8;
+
+    ArgList() = default;
+
+    ArgList(std::initializer_list<std::string_view> args) : ArgList(args.begin(), args.end()) {}
+
+    template <typename It>
+    ArgList(It first, It last) {
+        for (; first != last; ++first) {
+            push_back(*first);
+        }
+    }
+
+    void push_back(std::string_view arg) {
+        if (count < inlineCapacity) {
+            inlineArgs[count++] = arg;
+            return;
+        }
+        if (heap.empty()) {
+            heap.assign(inlineArgs, inlineArgs + count);
+        }
+        heap.push_back(arg);
+        count++;
+    }
+
+    const std::string_view* begin() const {
+        return heap.empty() ? inlineArgs : heap.data();
+    }
+
+    const std::string_view* end() const {
+        return begin() + count;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    std::string_view operator[](size_t i) const {
+        return begin()[i];
+    }
+
+private:
+    std::string_view inlineArgs[inlineCapacity];
+    std::vector<std::string_view> heap; // all of them once there are more than fit inline
+    size_t count = 0;
+};
+
+// what parse_args didn't like, pos is an offset into the text it parsed
+struct ArgError {
+    size_t pos = std::string_view::npos;
+    const char* message = "";
+
+    explicit operator bool() const {
+        return pos != std::string_view::npos;
+    }
+};
+
+// Command arguments are prose, so an apostrophe is just an apostrophe. Code arguments (FUNC_ARG) also keep
+// character literals and template argument lists together.
+enum class ArgSyntax {
+    Command,
+    Code
+};
+
+// one past the closing quote of the literal whose opening quote is at pos, or npos if it never closes
+inline size_t skip_quoted(std::string_view src, size_t pos) {
+    const char quote = src[pos];
+    const char* base = src.data();
+    const char* end = base + src.size();
+    for (pos++; pos < src.size(); pos += 2) {
+        pos = simd::find_any(base + pos, end, simd::ByteSet(quote, '\\')) - base;
+        if (pos < src.size() && src[pos] == quote) {
+            return pos + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// true if the '<' at pos opens a template argument list rather than being a comparison or a shift
+inline bool opens_template(std::string_view src, size_t pos) {
+    if (pos + 1 < src.size() && (src[pos+1] == '<' || src[pos+1] == '=')) {
+        return false;
+    }
+    // a template name is right before it, "a < b" has a space
+    return pos > 0 && (std::isalpha((unsigned char) src[pos-1]) || src[pos-1] == '_');
+}
+
+// Finds which of the '<'s that opens_template accepts from pos on really open a template argument list: those with a
+// '>' of their own before the bracket around them closes. A '>' belongs to the innermost '<' still open at its level,
+// so "a<b, c<d>" opens one list, at c, and "x = a<b, y = 2" none. It stops where the bracket pos is in closes, and
+// opens ends up sorted.
+inline void match_templates(std::string_view src, size_t pos, std::vector<size_t>& opens) {
+    const size_t level = std::string_view::npos; // separates the '<'s of nested brackets
+    std::vector<size_t> open;
+    for (; pos < src.size(); pos++) {
+        char c = src[pos];
+        if (c == '"' || (c == '\'' && !lexer_detail::digit_separator(src, pos))) {
+            size_t end = skip_quoted(src, pos);
+            if (end == std::string_view::npos) {
+                break;
+            }
+            pos = end - 1;
+        } else if (c == '(' || c == '[' || c == '{') {
+            open.push_back(level);
+        } else if (c == ')' || c == ']' || c == '}') {
+            while (!open.empty() && open.back() != level) {
+                open.pop_back();
+            }
+            if (open.empty()) {
+                break;
+            }
+            open.pop_back();
+        } else if (c == '<' && opens_template(src, pos)) {
+            open.push_back(pos);
+        } else if (c == '>' && src[pos-1] != '-' && !open.empty() && open.back() != level) {
+            opens.push_back(open.back());
+            open.pop_back();
+        }
+    }
+    std::sort(opens.begin(), opens.end());
+}
+
+// the arguments of the command whose '(' is at index, as stripped views into src; index ends up on the closing ')'
+// Commas split arguments only outside (), [], {} and string literals, which may contain escaped quotes.
+// If the list never closes, the rest of src is the last argument, index is left alone and error says why.
+inline ArgList parse_args(std::string_view src, size_t& index, ArgError* error = nullptr, ArgSyntax syntax = ArgSyntax::Command) {
+    ArgList args;
+    size_t argStart = index + 1;
+    int parenDepth = 0;
+    int nesting = 0; // [] and {}
+    int angleDepth = 0; // template <>, only counted for code
+    bool matched = false; // whether a '<' was left open, and templates says which '<'s open template argument lists
+    std::vector<size_t> templates;
+    for (size_t i = index + 1; i < src.size(); i++) {
+        char c = src[i];
+        if (c == '"' || (c == '\'' && syntax == ArgSyntax::Code && !lexer_detail::digit_separator(src, i))) {
+            size_t end = skip_quoted(src, i);
+            if (end == std::string_view::npos) {
+                if (error) *error = {i, c == '"' ? "unterminated string" : "unterminated character literal"};
+                break;
+            }
+            i = end - 1;
+        } else if (c == '(') {
+            parenDepth++;
+        } else if (c == ')') {
+            if (--parenDepth < 0 && angleDepth > 0 && !matched) {
+                // a '<' never closed, so it was a less-than, like in "int x = a<b, int y": start over knowing which
+                // ones open a template argument list
+                matched = true;
+                match_templates(src, index + 1, templates);
+                args = ArgList();
+                argStart = index + 1;
+                parenDepth = 0;
+                nesting = 0;
+                angleDepth = 0;
+                i = index;
+            } else if (parenDepth < 0) {
+                args.push_back(strip(src.substr(argStart, i - argStart)));
+                index = i;
+                return args;
+            }
+        } else if (c == '[' || c == '{') {
+            nesting++;
+        } else if (c == ']' || c == '}') {
+            nesting--;
+        } else if (syntax == ArgSyntax::Code && c == '<' && opens_template(src, i)
+                   && (!matched || std::binary_search(templates.begin(), templates.end(), i))) {
+            angleDepth++;
+        } else if (c == '>' && angleDepth > 0 && src[i-1] != '-') {
+            angleDepth--;
+        } else if (c == ',' && parenDepth == 0 && nesting == 0 && angleDepth == 0) {
+            args.push_back(strip(src.substr(argStart, i - argStart)));
+            argStart = i + 1;
+        }
+    }
+    if (error && !*error) *error = {index, "missing ')'"};
+    args.push_back(strip(src.substr(std::min(argStart, src.size()))));
+    return args;
+}
+
+// The declaration after a doc comment, as the extraction commands (FUNC_*, NEXT_DECL, CLASS_NAME, NEXT_MACRO) print it.
+// It is filled in a part at a time, so an alias running several of these commands parses the declaration once.
+// The views point into the source the commands were given.
+struct Declaration {
+    enum Part : uint8_t {
+        Parsed = 1, // kind, decl, className, name, returnType, args, key, bases and body
+        Arguments = 2, // argList
+        Macro = 4 // macro
+    };
+
+    size_t bound = 0; // size of the source it was found in, aliases see less of it
+    uint8_t parts = 0; // the parts found so far
+    size_t limit = 0; // where looking for it stops: the next doc comment, or the lookahead after the comment
+    bool cut = false; // the lookahead ran out before the declaration ended
+    DeclKind kind = DeclKind::Other;
+    std::string_view decl; // NEXT_DECL, without its ';'
+    std::string_view className; // CLASS_NAME: the class declared, or the one a member defined outside of it belongs to
+    std::string_view name; // FUNC_NAME
+    std::string_view returnType; // FUNC_RET
+    std::string_view args; // FUNC_ARGS
+    ClassKey key = ClassKey::Class; // for classes
+    std::string_view bases; // CLASS_BASES
+    size_t body = 0; // the '{' of a class body, or the end of the source
+    size_t paren = 0; // where the argument list starts and ends
+    size_t parenClose = 0;
+    ArgList argList; // the arguments for FUNC_ARG
+    std::string_view macro; // NEXT_MACRO, without its ')'
+    bool macroParams = false; // the macro is function-like, so NEXT_MACRO closes its parameters
+};
+
+// where the source a comment ending just before after may look at stops, for a source of that size
+inline size_t lookahead_end(size_t after, size_t size, size_t lookahead) {
+    return lookahead < size - after ? after + lookahead : size;
+}
+
+inline void find_declaration(Declaration& d, uint8_t parts, const CommentData& comment, std::string_view src, const TokenTable& tokens, size_t lookahead) {
+    const size_t after = std::min(comment.end_index+1, src.size());
+    // the argument list is split out of the parsed one
+    if (parts & Declaration::Arguments) {
+        parts |= Declaration::Parsed;
+    }
+    if (d.parts == 0) {
+        // a comment with no declaration after it mustn't make its commands read the rest of the file:
+        // stop at the next doc comment, and after lookahead bytes at most
+        d.limit = lookahead_end(after, src.size(), lookahead);
+        d.cut = false;
+        auto it = std::lower_bound(tokens.tokens.begin(), tokens.tokens.end(), after, [](const Token& t, size_t p) { return t.begin < p; });
+        for (; it != tokens.tokens.end() && it->begin < d.limit; ++it) {
+            if (!it->is_comment()) {
+                continue;
+            }
+            // when streaming, src can end inside the comment, and only the part of it that's there is looked at
+            std::string_view body = it->end <= src.size() ? comment_body(src, *it) : src.substr(std::min(it->begin + it->open, src.size()));
+            if (has_doc_marker(body)) {
+                d.limit = it->begin;
+                break;
+            }
+        }
+    }
+    parts &= ~d.parts;
+    d.parts |= parts;
+    d.bound = src.size();
+    auto view = [&](size_t begin, size_t end) {
+        return begin < end && end != ParsedDeclaration::none ? strip(src.substr(begin, end - begin)) : std::string_view();
+    };
+    if (parts & Declaration::Parsed) {
+        size_t first = after;
+        while (first < src.size() && std::isspace((unsigned char) src[first])) {
+            first++;
+        }
+        const Token* directive = first < d.limit && src[first] == '#' ? tokens.next_preprocessor(first, first + 1) : nullptr;
+        if (directive && src.compare(first, 7, "#define") == 0) {
+            // a macro is its #define line
+            size_t end = std::min(lexer_detail::line_end(src, first), d.limit);
+            size_t name = first + 7;
+            while (name < end && std::isspace((unsigned char) src[name])) name++;
+            size_t nameEnd = name;
+            while (nameEnd < end && lexer_detail::is_ident(src[nameEnd])) nameEnd++;
+            d.kind = DeclKind::Macro;
+            d.decl = view(first, end);
+            d.name = view(name, nameEnd);
+            d.className = d.returnType = d.args = d.bases = std::string_view();
+            d.body = d.paren = d.parenClose = src.size();
+            if (nameEnd < end && src[nameEnd] == '(') {
+                // a function-like macro's parameters
+                d.paren = nameEnd;
+                d.parenClose = std::min(src.find(')', nameEnd), end);
+                d.args = view(d.paren + 1, d.parenClose);
+            }
+        } else {
+            ParsedDeclaration parsed = parse_declaration(src.substr(0, d.limit), after);
+            d.cut = parsed.end == d.limit && d.limit - after == lookahead;
+            d.kind = parsed.kind;
+            d.decl = view(after, parsed.end);
+            d.name = view(parsed.nameBegin, parsed.nameEnd);
+            d.className = parsed.kind == DeclKind::Class ? d.name : view(parsed.scopeBegin, parsed.scopeEnd);
+            d.returnType = view(parsed.typeBegin, parsed.typeEnd);
+            d.args = view(parsed.paramsBegin, parsed.paramsEnd);
+            d.key = parsed.key;
+            d.bases = view(parsed.basesBegin, parsed.basesEnd);
+            d.body = parsed.kind == DeclKind::Class && parsed.end < d.limit && src[parsed.end] == '{' ? parsed.end : src.size();
+            d.paren = parsed.paramsBegin == ParsedDeclaration::none ? src.size() : parsed.paramsBegin - 1;
+            d.parenClose = parsed.paramsEnd == ParsedDeclaration::none ? src.size() : parsed.paramsEnd;
+        }
+    }
+    if (parts & Declaration::Arguments) {
+        size_t index = 0;
+        // a cut off list still gives the arguments before the cut, so no error for it here
+        d.argList = d.paren < src.size()
+            ? parse_args(src.substr(d.paren, std::min(d.parenClose + 1, d.limit) - d.paren), index, nullptr, ArgSyntax::Code)
+            : ArgList();
+    }
+    if (parts & Declaration::Macro) {
+        // given #define ABC(a, b, ...) body, the part up to the ')', and given #define ABC body, the part up to the name
+        const Token* directive = tokens.next_preprocessor(after, d.limit);
+        size_t start = directive ? directive->begin : d.limit;
+        size_t end = start + 1;
+        for (int word = 0; word < 2; word++) {
+            // "define", then the name
+            while (end < d.limit && (src[end] == ' ' || src[end] == '\t')) end++;
+            while (end < d.limit && lexer_detail::is_ident(src[end])) end++;
+        }
+        d.macroParams = end < d.limit && src[end] == '(';
+        if (d.macroParams) {
+            end = std::min(src.find(')', end), d.limit);
+        }
+        end = std::min(end, d.limit);
+        d.macro = strip(src.substr(start, end-start));
+    }
+}
+
+// a source file as the commands of its doc comments see it
+struct SourceFile {
+    std::string_view text; // the whole file, or the part of it still in memory when streaming
+    std::string filename;
+    TokenTable tokens;
+    size_t firstLine = 1; // the line text starts on
+    LineIndex lines; // built the first time a command needs a line, most files never do
+    std::vector<Declaration> declarations; // of the comment at declarationsOf, one per source bound
+    size_t declarationsOf = std::string_view::npos;
+    size_t lookahead = std::string_view::npos; // how far after a comment its declaration is looked for
+    size_t warnedOf = std::string_view::npos; // the comment the last lookahead warning was for
+    const ClassMember* member = nullptr; // the member CLASS_MEMBERS is running a command for
+    SymbolTable* symbols = nullptr; // where the symbol of the comment at symbolOf is named, once its declaration is parsed
+    size_t symbolOf = std::string_view::npos;
+    size_t symbol = 0; // the id of that symbol
+
+    SourceFile(std::string_view text, std::string filename, TokenTable tokens = {})
+        : text(text), filename(std::move(filename)), tokens(std::move(tokens)) {}
+
+    const LineIndex& line_index() {
+        if (!lines.built()) {
+            lines.build(text, firstLine);
+        }
+        return lines;
+    }
+
+    // "path:line" of offset, for diagnostics
+    std::string location(size_t offset) {
+        return filename + ":" + std::to_string(line_index().line_number(offset));
+    }
+
+    // the declaration after comment with at least those parts, found the first time one of its commands asks
+    // quiet leaves the warning about the lookahead to the commands, for when nothing in the comment asked for it
+    const Declaration& declaration(const CommentData& comment, std::string_view src, uint8_t parts, bool quiet = false) {
+        if (declarationsOf != comment.index) {
+            // keep the entries around, they are reused for the next comment
+            for (Declaration& old : declarations) {
+                old.parts = 0;
+            }
+            declarationsOf = comment.index;
+        }
+        Declaration* d = nullptr;
+        for (Declaration& known : declarations) {
+            if (known.parts == 0 || known.bound == src.size()) {
+                d = &known;
+                break;
+            }
+        }
+        if (!d) {
+            d = &declarations.emplace_back();
+        }
+        if ((d->parts & parts) != parts) {
+            find_declaration(*d, parts, comment, src, tokens, lookahead);
+        }
+        if (comment.index == symbolOf && (d->parts & Declaration::Parsed)) {
+            // Foo::bar for members defined outside of their class, the plain name for everything else
+            symbolOf = std::string_view::npos;
+            if (!d->name.empty()) {
+                symbols->name(symbol, d->kind != DeclKind::Class ? d->className : std::string_view(), d->name);
+            }
+        }
+        if (!quiet && d->cut && warnedOf != comment.index) {
+            warnedOf = comment.index;
+            std::cerr << location(comment.index) << ": Warning: no end of the declaration within " << lookahead
+                      << " bytes of the doc comment, see --lookahead\n";
+        }
+        return *d;
+    }
+};
+
+// the buffer documentation goes to: the current section, or the main one
+inline std::string& section_buffer(DocContext& context) {
+    if (context.currentSection.empty()) {
+        return context.mainSection;
+    }
+    return context.sections[context.currentSection];
+}
+
+// puts the anchor markers waiting for a comment's documentation in front of its first visible byte, if buffer now has
+// one after from; next to text, they don't change what simplify_md does
+inline void place_anchors(std::string& buffer, size_t from, DocContext& context) {
+    while (from < buffer.size() && lexer_detail::is_space(buffer[from])) {
+        from++;
+    }
+    if (from < buffer.size()) {
+        buffer.insert(from, context.pendingAnchors);
+        context.pendingAnchors.clear();
+    }
+}
+
+inline void process_char(char c, DocContext& context) {
+    context.emittedBytes++;
+    std::string& buffer = section_buffer(context);
+    buffer += c;
+    if (!context.pendingAnchors.empty()) place_anchors(buffer, buffer.size() - 1, context);
+}
+
+inline void process_string(std::string_view s, DocContext& context) {
+    // nothing to write must not create the section
+    if (s.empty()) {
+        return;
+    }
+    context.emittedBytes += s.size();
+    std::string& buffer = section_buffer(context);
+    buffer.append(s.data(), s.size());
+    if (!context.pendingAnchors.empty()) place_anchors(buffer, buffer.size() - s.size(), context);
+}
+
+inline void process_simplified(std::string_view s, DocContext& context) {
+    if (strip(s).empty()) {
+        return;
+    }
+    std::string& buffer = section_buffer(context);
+    size_t before = buffer.size();
+    append_simplified(s, buffer);
+    context.emittedBytes += buffer.size() - before;
+    if (!context.pendingAnchors.empty()) place_anchors(buffer, before, context);
+}
+
+// adds the symbol documented by comment to the symbol table, with its anchor where the comment's documentation starts.
+// It gets its name if a command of the comment parses the declaration after it; a comment that never looks at its
+// declaration documents nothing @REF can find, and costs no parse
+inline void register_symbol(DocContext& context, SourceFile& file, const CommentData& comment) {
+    file.symbols = &context.symbols;
+    file.symbolOf = comment.index;
+    file.symbol = context.symbols.reserve(context.pendingAnchors);
+}
+
+inline bool process_comment(std::string_view cmt, bool doc, DocContext& context, const CommentData& comment, std::string_view src, SourceFile& file, size_t expandedAt = std::string_view::npos);
+
+// at is where the command is in the source, for diagnostics
+inline void process_src_command(std::string_view command, const ArgList& args, DocContext& context, const CommentData& comment, std::string_view src, SourceFile& file, size_t at, bool simplify) {
+    command = strip(command);
+    if (command.size() >= 2 && command[0] == 'S' && command[1] == '_') {
+        command = command.substr(2);
+        simplify = true;
+    }
+    CommandScope commandStats(context.stats, command, context.emittedBytes);
+    // where the source after the comment starts
+    const size_t after = std::min(comment.end_index+1, src.size());
+    auto process_str = [simplify, &context] (std::string_view s) {
+        if (simplify) process_simplified(s, context);
+        else process_string(s, context);
+    };
+    if (command == "SECTION") {
+        if (context.memory) context.memory->charge(context.currentSection);
+        if (args.empty()) {
+            context.currentSection = "";
+        } else {
+            context.currentSection = args[0];
+        }
+    } else if (command == "NEXT_LINE") {
+        // the rest of the line after the end of comment
+        const LineIndex& lines = file.line_index();
+        size_t end = std::min(lines.line_end(lines.line_of(after)), src.size());
+        size_t start = std::min(comment.end_index, src.size());
+        process_str(strip(src.substr(start, end-start)));
+    } else if (command == "NEXT_LINES") {
+        // the next n lines after the comment as they are, indentation included
+        long n = args.size() == 1 ? std::strtol(std::string(args[0]).c_str(), nullptr, 10) : 0;
+        if (n <= 0) {
+            std::cerr << file.location(at) << ": Error: NEXT_LINES requires a line count\n";
+            return;
+        }
+        const LineIndex& lines = file.line_index();
+        size_t first = lines.line_of(after);
+        size_t last = std::min(first + (size_t) n, lines.starts.size()) - 1;
+        size_t start = lines.starts[first];
+        if (start < comment.end_index) {
+            // code right after the comment on the same line
+            start = comment.end_index;
+            while (start < src.size() && (src[start] == ' ' || src[start] == '\t')) {
+                start++;
+            }
+        }
+        start = std::min(start, src.size());
+        size_t end = std::max(std::min(lines.line_end(last), src.size()), start);
+        std::string_view text = src.substr(start, end-start);
+        while (!text.empty() && std::isspace((unsigned char) text.back())) {
+            text.remove_suffix(1);
+        }
+        process_str(text);
+    } else if (command == "LINE_NUMBER") {
+        // the line the documented code starts on
+        process_str(std::to_string(file.line_index().line_number(after)));
+    } else if (command == "FUNC_NAME") {
+        process_str(file.declaration(comment, src, Declaration::Parsed).name);
+    } else if (command == "NEXT_DECL") {
+        // the declaration after comment, without its body, initializer or a constructor's initializer list
+        process_str(file.declaration(comment, src, Declaration::Parsed).decl);
+        process_str(";");
+    } else if (command == "FUNC_RET") {
+        // the return type, without specifiers like static or virtual
+        process_str(file.declaration(comment, src, Declaration::Parsed).returnType);
+    } else if (command == "FUNC_ARGS") {
+        process_str(file.declaration(comment, src, Declaration::Parsed).args);
+    } else if (command == "FUNC_ARG") {
+        char* numberEnd = nullptr;
+        std::string number(args.empty() ? std::string_view() : args[0]);
+        long argNum = std::strtol(number.c_str(), &numberEnd, 10);
+        if (args.size() != 1) {
+            std::cerr << file.location(at) << ": Error: FUNC_ARG requires 1 argument\n";
+            return;
+        }
+        if (number.empty() || *numberEnd != '\0') {
+            std::cerr << file.location(at) << ": Error: FUNC_ARG needs an argument number, not " << args[0] << '\n';
+            return;
+        }
+        const ArgList& argList = file.declaration(comment, src, Declaration::Arguments).argList;
+        if (argNum < 0) {
+            argNum += (long) argList.size();
+        }
+        if (argNum < 0 || argNum >= (long) argList.size()) {
+            std::cerr << file.location(at) << ": Error: Argument " << args[0] << " not found\n";
+            return;
+        }
+        process_str(argList[argNum]);
+    } else if (command == "CLASS_NAME") {
+        // the class declared, or the one a member defined outside of it belongs to
+        process_str(file.declaration(comment, src, Declaration::Parsed).className);
+    } else if (command == "CLASS_BASES") {
+        // the base list as written, like "public Base<int>, private Other"
+        process_str(file.declaration(comment, src, Declaration::Parsed).bases);
+    } else if (command == "CLASS_MEMBERS") {
+        // runs a command or alias (NEXT_DECL if none is given) for each member of the class after comment, as if a
+        // comment ended right before the member, one member per line; more arguments keep only members with that access,
+        // like CLASS_MEMBERS(METHOD, public, protected)
+        uint8_t accessMask = args.size() > 1 ? 0 : 0xff;
+        for (size_t i = 1; i < args.size(); i++) {
+            if (args[i] == "public") accessMask |= 1 << (int) Access::Public;
+            else if (args[i] == "protected") accessMask |= 1 << (int) Access::Protected;
+            else if (args[i] == "private") accessMask |= 1 << (int) Access::Private;
+            else {
+                std::cerr << file.location(at) << ": Error: CLASS_MEMBERS: unknown access " << args[i] << '\n';
+                return;
+            }
+        }
+        const Declaration& d = file.declaration(comment, src, Declaration::Parsed);
+        if (d.body >= src.size()) {
+            std::cerr << file.location(at) << ": Error: CLASS_MEMBERS needs a class definition after the comment\n";
+            return;
+        }
+        // the members' commands replace the declaration d points into, so the walk gets its own list
+        std::vector<ClassMember> members;
+        parse_class_body(src.substr(0, lookahead_end(after, src.size(), file.lookahead)), d.body, d.key, members);
+        std::string_view each = args.empty() || args[0].empty() ? std::string_view("NEXT_DECL") : args[0];
+        std::string_view className = d.name;
+        const ClassMember* outer = file.member;
+        bool first = true;
+        for (const ClassMember& member : members) {
+            if (!(accessMask & (1 << (int) member.access))) {
+                continue;
+            }
+            // aliases start and end with a newline of their own
+            const std::string& out = section_buffer(context);
+            if (!first && !out.empty() && out.back() != '\n') {
+                process_str("\n");
+            }
+            first = false;
+            file.member = &member;
+            CommentData memberComment{member.begin, member.begin - 1, member.begin, member.begin};
+            std::string_view memberSrc = src.substr(0, member.end);
+            // members are symbols of their own, Foo::bar
+            const Declaration& memberDecl = file.declaration(memberComment, memberSrc, Declaration::Parsed, true);
+            if (!memberDecl.name.empty() && !className.empty()) {
+                context.symbols.name(context.symbols.reserve(context.pendingAnchors), className, memberDecl.name);
+            }
+            process_src_command(each, {}, context, memberComment, memberSrc, file, at, simplify);
+        }
+        file.member = outer;
+    } else if (command == "MEMBER_ACCESS") {
+        // public, protected or private, for the member CLASS_MEMBERS runs this for
+        static constexpr std::string_view names[] = {"public", "protected", "private"};
+        if (file.member) {
+            process_str(names[(int) file.member->access]);
+        }
+    } else if (command == "REF") {
+        // a link to where a symbol is documented, in this file or any other, resolved once all of them are known
+        if (args.empty() || args.size() > 2 || args[0].empty()) {
+            std::cerr << file.location(at) << ": Error: REF requires a symbol and optionally the link text\n";
+            return;
+        }
+        process_str(context.symbols.reference(args[0], args.size() == 2 ? args[1] : std::string_view(), file.location(at)));
+    } else if (command == "NEXT_MACRO") {
+        // given #define ABC sdfsdfsf
+        // return #define ABC
+        // given #define ABC(a, b, ...) sdfsdfsf
+        // return #define ABC(a, b, ...)
+        // parsed as well, which for a #define is just its line, so the macro gets a symbol
+        const Declaration& d = file.declaration(comment, src, Declaration::Macro | Declaration::Parsed);
+        process_str(d.macro);
+        if (d.macroParams) {
+            process_str(")");
+        }
+    } else if (command == "FILE_NAME") {
+        // just the filename, no path
+        fs::path p(file.filename);
+        process_str(p.filename().string());
+    }
+
+
+    else if (command == "SIMPLIFY" || command == "S") {
+        if (args.size() == 1) {
+            process_src_command(args[0], {}, context, comment, src, file, at, true);
+        } else if (args.size() > 1) {
+            ArgList new_args(args.begin() + 1, args.end());
+            process_src_command(args[0], new_args, context, comment, src, file, at, true);
+
+        } else {
+            std::cerr << file.location(at) << ": Wrong number of arguments in SIMPLIFY!" << std::endl;
+        }
+    } else if (auto alias = context.aliases.find(std::string(command)); alias != context.aliases.end()) {
+        // the alias text is run like a doc comment of its own, against the source after this comment
+        // up to the next comment, so its commands work properly
+        const Token* next = file.tokens.next_comment(after);
+        std::string_view next_src = src.substr(0, next ? std::min(next->begin, src.size()) : src.size());
+        commandStats.kind = "alias";
+        TraceScope span(context.tracer, "alias", command);
+        span.arg("file", file.filename);
+        // expands like "@DOC\n<alias>\n@END" would
+        process_char('\n', context);
+        if (process_comment(alias->second, true, context, comment, next_src, file, at)) {
+            process_char('\n', context);
+        }
+    }
+
+    else {
+        std::string name(command);
+        if (fs::exists(context.outputDir / "commands" / (name + ".so"))) {
+//            std::cout << "Found command " << command << '\n';
+            commandStats.kind = "plugin";
+            // load
+            TraceScope loadSpan(context.tracer, "dlopen", command);
+            LIB_HANDLE lib = LIB_LOAD((context.outputDir / "commands" / (name + ".so")).string().c_str());
+            if (!lib) {
+                std::cerr << file.location(at) << ": Error: Could not load command " << command << '\n';
+                return;
+            }
+            // get function
+            std::string (*func)(const std::string&, const std::vector<std::string>&);
+            func = (std::string (*)(const std::string&, const std::vector<std::string>&))LIB_GET_FUNC(lib, ("_Z" + std::to_string(name.size()) + name + "RKNSt7__cxx1112basic_stringIcSt11char_traitsIcESaIcEEERKSt6vectorIS4_SaIS4_EE").c_str());
+            if (!func) {
+                std::cerr << file.location(at) << ": Error: Could not find function " << command << '\n';
+                return;
+            }
+            loadSpan.stop();
+            // call function
+            // the function takes the code after the comment as an argument, plugins get their own copies
+            TraceScope callSpan(context.tracer, "plugin", command);
+            std::string code_after_comment(src.substr(after));
+            std::vector<std::string> pluginArgs(args.begin(), args.end());
+            if (context.memory) context.memory->pluginCopies.add(code_after_comment.size());
+            std::string result = func(code_after_comment, pluginArgs);
+            callSpan.arg("bytes_in", code_after_comment.size());
+            callSpan.arg("bytes_out", result.size());
+            callSpan.stop();
+            process_str(result);
+            // close
+            TraceScope closeSpan(context.tracer, "dlclose", command);
+            LIB_CLOSE(lib);
+
+
+        } else {
+            commandStats.kind = "unknown";
+            std::cerr << file.location(at) << ": Error: Unknown command " << command << '\n';
+        }
+    }
+}
+
+// runs the commands in the text of one comment and writes out its documentation
+// doc says whether it starts out as documentation, which is the case for alias text; returns whether it still is at the end
+// cmt is the comment's text in src, or alias text used at expandedAt, where its commands are then reported
+inline bool process_comment(std::string_view cmt, bool doc, DocContext& context, const CommentData& comment, std::string_view src, SourceFile& file, size_t expandedAt) {
+    // find commands inside the comment
+    // a command is '@' followed by all caps, and then (optional) arguments
+    size_t index = 0;
+    while (index < cmt.size()) {
+        if (cmt[index] == '@' && index + 1 < cmt.size() && std::isupper(cmt[index + 1])) {
+            // keep going as long as it is a letter, underscore, or number
+            size_t end = index + 1;
+            while (end < cmt.size() && (std::isalnum(cmt[end]) || cmt[end] == '_')) {
+                end++;
+            }
+            std::string_view cmdName = cmt.substr(index + 1, end - index - 1);
+            size_t at = expandedAt != std::string_view::npos ? expandedAt : comment.text_begin + index;
+            ArgList args;
+            // find the arguments
+            index = end;
+            // if the next thing is a '(' then there is arguments
+            if (index < cmt.size() && cmt[index] == '(') {
+                ArgError error;
+                args = parse_args(cmt, index, &error);
+                if (error && doc) {
+                    size_t where = expandedAt != std::string_view::npos ? expandedAt : comment.text_begin + error.pos;
+                    std::cerr << file.location(where) << ": Error: " << error.message << " in the arguments of " << cmdName << '\n';
+                }
+                index++;
+            }
+
+            if (cmdName == "DOC") {
+                doc = true;
+            } else if (cmdName == "END") {
+                doc = false;
+            } else {
+                if (doc) {
+                    process_src_command(cmdName, args, context, comment, src, file, at, false);
+
+                }
+            }
+            // if there is \( right after the command, then remove the \ a
+            if (index + 1 < cmt.size() && cmt[index] == '\\' && cmt[index + 1] == '(') {
+                index++;
+            }
+        } else {
+            // everything up to the next '@' is literal text, written out in one go
+            size_t end = simd::find_any(cmt.data() + index + 1, cmt.data() + cmt.size(), '@') - cmt.data();
+            if (doc) {
+                process_string(cmt.substr(index, end - index), context);
+            }
+            index = end;
+        }
+    }
+    return doc;
+}
+
+// the comment data of a lexed comment, false for anything that isn't a comment with the @DOC marker
+inline bool doc_comment(std::string_view src, const Token& token, CommentData& comment) {
+    if (!token.is_comment()) {
+        return false;
+    }
+    std::string_view text = strip(comment_body(src, token));
+    if (!has_doc_marker(text)) {
+        return false;
+    }
+    size_t begin = text.data() - src.data();
+    comment = {token.begin, token.end, begin, begin + text.size()};
+    return true;
+}
+
+inline void process_source(std::string_view src, DocContext& context, const std::string& filename) {
+    PerfScope perfScope(context.perf, PerfRegion::ProcessSource, src.size());
+    // for each doc comment in the source, create a comment data object
+    std::vector<CommentData> comments;
+    ProfileScope scanScope(context.profiler, Phase::ScanComments, src.size());
+    // comments come from the lexer, so comment markers inside string literals don't count
+    SourceFile file(src, filename, lex_source(src, language_for(filename)));
+    file.lookahead = context.lookahead;
+    for (const Token& token : file.tokens.tokens) {
+        CommentData comment;
+        if (doc_comment(src, token, comment)) {
+            comments.push_back(comment);
+        }
+    }
+    scanScope.stop();
+
+    // go through each comment and process it
+    ProfileScope commandScope(context.profiler, Phase::RunCommands);
+    for (const CommentData& comment : comments) {
+        if (context.memory) context.memory->mark();
+        register_symbol(context, file, comment);
+        process_comment(src.substr(comment.text_begin, comment.text_end - comment.text_begin), false, context, comment, src, file);
+        if (context.memory) context.memory->charge(context.currentSection);
+        context.currentSection = "";
+        context.pendingAnchors.clear();
+    }
+}
+
+// process_source for files too big to hold in memory, see --stream-above
+// The file is read in windows of context.streamWindow bytes. A doc comment runs once every token starting within
+// context.lookahead bytes after it has been read (or the file ended), and its commands see no further than the end of
+// those tokens. Everything before the oldest comment
+// still waiting and the lexer's restart point is dropped, so memory stays at about window + lookahead + the longest
+// comment, literal or preprocessor line, however big the file is. Tokens cut off by the end of a window are lexed
+// again once the rest has been read.
+inline bool process_source_stream(const fs::path& path, DocContext& context, const std::string& filename) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    PerfScope perfScope(context.perf, PerfRegion::ProcessSource, 0);
+    // bytes kept before the restart point for the lexer's lookbehind: raw string prefixes, digit separators, '#' at line start
+    const size_t lookbehind = 64;
+    std::string buffer; // the part of the file still needed
+    SourceFile file({}, filename); // its tokens are the complete tokens in buffer, its lines start at the first byte kept
+    file.lookahead = context.lookahead;
+    const Language language = language_for(filename);
+    std::deque<CommentData> pending; // doc comments waiting for their lookahead
+    size_t resume = 0; // where lexing continues, never inside a token
+    size_t total = 0;
+    bool eof = false;
+    while (!eof) {
+        ProfileScope readScope(context.profiler, Phase::ReadSources);
+        size_t old = buffer.size();
+        buffer.resize(old + context.streamWindow);
+        in.read(&buffer[old], (std::streamsize) context.streamWindow);
+        size_t got = (size_t) in.gcount();
+        buffer.resize(old + got);
+        total += got;
+        eof = got < context.streamWindow;
+        readScope.stop();
+        file.text = buffer;
+        file.lines.clear();
+
+        ProfileScope scanScope(context.profiler, Phase::ScanComments, buffer.size() - resume);
+        TokenTable fresh = lex_source(buffer, language, resume);
+        // the last byte may start a token together with the next window, like "/" and "/"
+        resume = eof || buffer.empty() ? buffer.size() : buffer.size() - 1;
+        for (const Token& token : fresh.tokens) {
+            if (!eof && token.end >= buffer.size()) {
+                // it may go on in the next window, along with anything inside it
+                resume = token.begin;
+                break;
+            }
+            file.tokens.tokens.push_back(token);
+            CommentData comment;
+            if (doc_comment(buffer, token, comment)) {
+                pending.push_back(comment);
+            }
+        }
+        scanScope.stop();
+
+        ProfileScope commandScope(context.profiler, Phase::RunCommands);
+        // a comment waits until every token starting within its lookahead is complete, so its commands see the same
+        // tokens as without streaming
+        while (!pending.empty() && (eof || resume >= pending.front().end_index + 1 + context.lookahead)) {
+            const CommentData& comment = pending.front();
+            // the token the lookahead ends in is kept whole, so a doc comment there still ends the declaration before it
+            size_t end = comment.end_index + 1 + context.lookahead;
+            const std::vector<Token>& tokens = file.tokens.tokens;
+            auto last = std::lower_bound(tokens.begin(), tokens.end(), end, [](const Token& t, size_t p) { return t.begin < p; });
+            if (last != tokens.begin() && std::prev(last)->end > end) {
+                end = std::prev(last)->end;
+            }
+            std::string_view src = std::string_view(buffer).substr(0, std::min(end, buffer.size()));
+            if (context.memory) context.memory->mark();
+            register_symbol(context, file, comment);
+            process_comment(src.substr(comment.text_begin, comment.text_end - comment.text_begin), false, context, comment, src, file);
+            if (context.memory) context.memory->charge(context.currentSection);
+            context.currentSection = "";
+            context.pendingAnchors.clear();
+            pending.pop_front();
+        }
+        commandScope.stop();
+
+        // drop what nothing needs anymore and move the offsets along
+        size_t cut = resume > lookbehind ? resume - lookbehind : 0;
+        if (!pending.empty()) {
+            cut = std::min(cut, pending.front().index);
+        }
+        if (cut == 0) {
+            continue;
+        }
+        file.firstLine += simd::count_byte(buffer.data(), buffer.data() + cut, '\n');
+        file.declarationsOf = file.warnedOf = std::string_view::npos;
+        buffer.erase(0, cut);
+        resume -= cut;
+        std::vector<Token>& tokens = file.tokens.tokens;
+        auto firstKept = std::lower_bound(tokens.begin(), tokens.end(), cut, [](const Token& t, size_t p) { return t.begin < p; });
+        tokens.erase(tokens.begin(), firstKept);
+        for (Token& token : tokens) {
+            token.begin -= cut;
+            token.end -= cut;
+        }
+        for (CommentData& comment : pending) {
+            comment.index -= cut;
+            comment.end_index -= cut;
+            comment.text_begin -= cut;
+            comment.text_end -= cut;
+        }
+    }
+    perfScope.bytes = total;
+    return true;
+}
+
+inline std::string simplify_md(const std::string& s) {
+    // only 1 empty line in a row is allowed
+    // if we find \n\s*\n\s*\n then we replace it with \n\n
+    std::regex re("\n[ \t]*\n[ \t]*\n");
+    return std::regex_replace(s, re, "\n\n");
+}
+
+inline void process_md_command(const std::string& command_, DocContext& context, size_t startLine, size_t endLine) {
+    std::string cmdName;
+    std::string command(strip(command_));
+    std::vector<std::string> args;
+    size_t pos = command.find('(');
+    if (pos != std::string::npos) {
+        cmdName = strip(std::string_view(command).substr(0, pos));
+        ArgError error;
+        for (std::string_view arg : parse_args(command, pos, &error)) {
+            args.emplace_back(arg);
+        }
+        if (error) {
+            size_t line = startLine + std::count(command.begin(), command.begin() + error.pos, '\n');
+            std::cerr << ".docgen:" << line << ": Error: " << error.message << " in the arguments of " << cmdName << '\n';
+        }
+    } else {
+        cmdName = command;
+    }
+    TraceScope span(context.tracer, "docgen", cmdName);
+    span.arg("start_line", startLine);
+    span.arg("end_line", endLine);
+
+    if (cmdName == "NEW_COMMAND") {
+        if (args.size() != 2 && args.size() != 3) {
+            std::cerr << "Error: NEW_COMMAND requires 2 arguments\n";
+            return;
+        }
+        ProfileScope compileScope(context.profiler, Phase::CompileCommands);
+        fs::path commandPath = context.outputDir / "commands" / (args[0] + ".cpp");
+        if (!fs::exists(commandPath.parent_path())) {
+            fs::create_directories(commandPath.parent_path());
+        }
+        std::string includes = "#include <string>\n#include<vector>\n";
+        std::string code;
+        if (args.size() == 3) {
+            includes += args[1];
+            code = args[2];
+        } else {
+            code = args[1];
+        }
+        std::string source = includes + "\nstd::string " + args[0] + "(const std::string &code, const std::vector<std::string> &args) \n" + code;
+        fs::path objectPath = context.outputDir / "commands" / (args[0] + ".so");
+        // a shared object built from the same source is reused, so later runs (and --repeat) don't pay for g++ again
+        std::error_code ec;
+        if (fs::exists(objectPath, ec) && fs::last_write_time(objectPath, ec) >= fs::last_write_time(commandPath, ec) && !ec) {
+            std::ifstream oldFile(commandPath, std::ios::binary);
+            std::string oldSource((std::istreambuf_iterator<char>(oldFile)), std::istreambuf_iterator<char>());
+            if (oldFile && oldSource == source) {
+                return;
+            }
+        }
+        std::ofstream commandFile(commandPath);
+        commandFile << source;
+        commandFile.close();
+        // compile the command into a shared object
+        std::string cmd = "g++ -shared -fPIC -o " + objectPath.string() + " " + commandPath.string();
+        system(cmd.c_str());
+//        std::cout << cmd << '\n';
+
+    } else if (cmdName == "PROCESS_SOURCES") {
+        auto directiveStart = Profiler::clock::now();
+        size_t directiveBytes = 0;
+        // glob
+        ProfileScope globScope(context.profiler, Phase::Glob);
+        std::vector<fs::path> sources = glob::rglob(args);
+        globScope.stop();
+        for (const fs::path& source : sources) {
+            auto fileStart = Profiler::clock::now();
+            TraceScope fileSpan(context.tracer, "source", source.string());
+            size_t bytes;
+            std::error_code sizeError;
+            uintmax_t fileSize = fs::file_size(source, sizeError);
+            if (!sizeError && fileSize >= context.streamAbove) {
+                if (!context.quiet) std::cout << "Processing " << source << " (streaming)\n";
+                if (!process_source_stream(source, context, source.string())) {
+                    std::cerr << "Error: Could not open " << source << '\n';
+                    continue;
+                }
+                bytes = fileSize;
+                if (context.memory) context.memory->sourceReads.add(bytes);
+            } else {
+                ProfileScope readScope(context.profiler, Phase::ReadSources);
+                MappedFile sourceFile;
+                if (!sourceFile.open(source)) {
+                    std::cerr << "Error: Could not open " << source << ": " << sourceFile.last_error() << '\n';
+                    continue;
+                }
+                std::string_view src = sourceFile.view();
+                readScope.stop();
+                if (context.memory) {
+                    (sourceFile.mapped() ? context.memory->sourceMaps : context.memory->sourceReads).add(src.size());
+                }
+                if (!context.quiet) std::cout << "Processing " << source << '\n';
+                process_source(src, context, source.string());
+                bytes = src.size();
+            }
+            context.sourceBytes += bytes;
+            fileSpan.arg("bytes", bytes);
+            if (context.profiler) {
+                context.profiler->phases[(size_t) Phase::ReadSources].bytes += bytes;
+                double seconds = std::chrono::duration<double>(Profiler::clock::now() - fileStart).count();
+                context.profiler->files.push_back({source.string(), seconds, bytes, 1});
+                directiveBytes += bytes;
+            }
+        }
+        if (context.profiler) {
+            std::string name;
+            for (const std::string& s : args) {
+                name += (name.empty() ? "" : ", ") + s;
+            }
+            double seconds = std::chrono::duration<double>(Profiler::clock::now() - directiveStart).count();
+            context.profiler->directives.push_back({name, seconds, directiveBytes, sources.size()});
+        }
+        if (sources.empty()) {
+            std::cerr << "Error: No sources found\n";
+            for (const std::string& s : args) {
+                std::cerr << s << '\n';
+            }
+        }
+    } else if (cmdName == "INSERT_SECTION") {
+        if (args.size() != 1) {
+            std::cerr << "Error: INSERT_SECTION requires 1 argument\n";
+            return;
+        }
+        if (context.sections.find(args[0]) == context.sections.end()) {
+            std::cerr << "Error: Section " << args[0] << " not found\n";
+            return;
+        }
+        ProfileScope simplifyScope(context.profiler, Phase::SimplifyMd, context.sections[args[0]].size());
+        PerfScope perfScope(context.perf, PerfRegion::SimplifyMd, context.sections[args[0]].size());
+        context.output += simplify_md(context.sections[args[0]]);
+        context.output += "\n\n";
+    } else if (cmdName == "NEW_ALIAS") {
+        if (args.size() != 2) {
+            std::cerr << "Error: NEW_ALIAS requires 2 arguments\n";
+            return;
+        }
+        std::string s(strip(args[1]));
+        // remove whatever was used to contain the alias data, () or {}
+        if (s[0] == '(' || s[0] == '{' || s[0] == '[' || s[0] == '"') {
+            s = s.substr(1, s.size()-2);
+        }
+        context.aliases[args[0]] = s;
+    }
+
+    else {
+        std::cerr << "Error: Unknown command " << cmdName << '\n';
+    }
+
+}
+
+// runs a whole .docgen file: its commands, the sources it processes, and writing index.md to context.outputDir
+inline void generate_docs(const fs::path& docgenPath, DocContext& context) {
+    // open the .docgen file
+    ProfileScope readScope(context.profiler, Phase::ReadDocgen);
+    std::ifstream docgenFile(docgenPath);
+    std::string docgenSrc;
+    // write entire file to string, then go back to beginning
+    docgenFile.seekg(0, std::ios::end);
+    docgenSrc.reserve(docgenFile.tellg());
+    docgenFile.seekg(0, std::ios::beg);
+    docgenSrc.assign((std::istreambuf_iterator<char>(docgenFile)), std::istreambuf_iterator<char>());
+    docgenFile.seekg(0, std::ios::beg);
+    readScope.stop();
+    if (context.profiler) context.profiler->phases[(size_t) Phase::ReadDocgen].bytes += docgenSrc.size();
+
+    // markdown unless @@ encountered on a new line
+    std::string line;
+    context.inputDocgen = docgenSrc;
+    ProfileScope parseScope(context.profiler, Phase::ParseDocgen, docgenSrc.size());
+    size_t lineNum = 0;
+    while (std::getline(docgenFile, line)) {
+        lineNum++;
+        if (line[0] == '@' && line[1] == '@') {
+            size_t pos = line.find("@@", 2);
+            if (pos != std::string::npos) {
+                std::string command = line.substr(2, pos-2);
+                process_md_command(command, context, lineNum, lineNum);
+            } else {
+                // the closing @@ is on a different line, if so, it MUST be at the beginning of the line, and the stuff after it is also part of the command
+                std::string command = line.substr(2);
+                size_t lineAdd = 0;
+                while (std::getline(docgenFile, line)) {
+                    lineAdd++;
+                    if (line[0] == '@' && line[1] == '@') {
+                        command += line.substr(2);
+                        break;
+                    } else {
+                        command += line + '\n';
+                    }
+                }
+                process_md_command(command, context, lineNum, lineNum + lineAdd);
+                lineNum += lineAdd;
+            }
+        } else {
+            context.output += line + '\n';
+        }
+    }
+    parseScope.stop();
+
+    ProfileScope simplifyScope(context.profiler, Phase::SimplifyMd, context.mainSection.size() + context.output.size());
+    {
+        PerfScope perfScope(context.perf, PerfRegion::SimplifyMd, context.mainSection.size() + context.output.size());
+        context.output += simplify_md(context.mainSection);
+        {
+            ProfileScope linkScope(context.profiler, Phase::LinkReferences, context.output.size());
+            context.symbols.link(context.output);
+        }
+        context.output = strip(simplify_md(context.output));
+    }
+    simplifyScope.stop();
+
+    ProfileScope writeScope(context.profiler, Phase::WriteOutput, context.output.size());
+    std::ofstream output(context.outputDir / "index.md");
+    output << context.output;
+    output.close();
+    writeScope.stop();
+}
@@ -1,6 +1,7 @@
 
 #pragma once
 #include <cassert>
+#include <chrono>
 #include <functional>
 #include <iostream>
 #include <map>
@@ -22,6 +23,40 @@ namespace glob {
     namespace fs = std::filesystem;
 #endif
 
+#ifdef GLOB_STATS
+    // Where globbing spends its time, only collected when GLOB_STATS is defined.
+    struct Stats {
+        size_t compiles = 0;        // compile_pattern
+        double compileSeconds = 0;
+        size_t matches = 0;         // fnmatch, including its compile_pattern
+        double matchSeconds = 0;
+        size_t hiddenChecks = 0;    // is_hidden, which compiles its own regex
+        double hiddenSeconds = 0;
+        size_t listings = 0;        // iter_directory
+        double listingSeconds = 0;
+        size_t entries = 0;         // entries returned by iter_directory
+    };
+
+    inline Stats stats;
+
+    struct StatsScope {
+        size_t &count;
+        double &seconds;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        StatsScope(size_t &count, double &seconds) : count(count), seconds(seconds) {}
+
+        ~StatsScope() {
+            count++;
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+
+#define GLOB_STATS_SCOPE(count, seconds) glob::StatsScope glob_stats_scope_(glob::stats.count, glob::stats.seconds)
+#else
+#define GLOB_STATS_SCOPE(count, seconds)
+#endif
+
     namespace {
 
         static inline
@@ -139,11 +174,13 @@ namespace glob {
 
         static inline
         std::regex compile_pattern(const std::string &pattern) {
+            GLOB_STATS_SCOPE(compiles, compileSeconds);
             return std::regex(translate(pattern), std::regex::ECMAScript);
         }
 
         static inline
         bool fnmatch(const fs::path &name, const std::string &pattern) {
+            GLOB_STATS_SCOPE(matches, matchSeconds);
             return std::regex_match(name.string(), compile_pattern(pattern));
         }
 
@@ -192,6 +229,7 @@ namespace glob {
 
         static inline
         bool is_hidden(const std::string &pathname) {
+            GLOB_STATS_SCOPE(hiddenChecks, hiddenSeconds);
             return std::regex_match(pathname, std::regex("^(.*\\/)*\\.[^\\.\\/]+\\/*$"));
         }
 
@@ -200,6 +238,7 @@ namespace glob {
 
         static inline
         std::vector<fs::path> iter_directory(const fs::path &dirname, bool dironly) {
+            GLOB_STATS_SCOPE(listings, listingSeconds);
             std::vector<fs::path> result;
 
             auto current_directory = dirname;
@@ -226,6 +265,9 @@ namespace glob {
                 }
             }
 
+#ifdef GLOB_STATS
+            stats.entries += result.size();
+#endif
             return result;
         }
 
@@ -0,0 +1,466 @@
+// Single pass lexers for C and C++ sources, and for Python, shell and Lua.
+// They don't produce a full token stream, only the spans that aren't plain code: comments, string and character
+// literals (raw strings included) and preprocessor lines. Everything after it works from this table instead of the
+// raw text, so a "//" in "http://..." or a "/*" in R"(...)" is never taken for a comment.
+// The language comes from the file extension (language_for); every language has its own scanner, instantiated from
+// lex_script for the scripting ones, so none of them looks for delimiters it doesn't have.
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "simd.hpp"
+
+enum class TokenKind : uint8_t {
+    LineComment,
+    BlockComment,
+    String,
+    Char,
+    RawString,
+    Preprocessor
+};
+
+struct Token {
+    size_t begin;
+    size_t end; // one past the last byte, line comments and preprocessor lines end before their newline
+    TokenKind kind;
+    uint8_t open = 0; // length of a comment's opening marker, like 2 for "//" or 4 for "--[["
+    uint8_t close = 0; // and of its closing one, 0 if it has none or was never closed
+
+    bool is_comment() const {
+        return kind == TokenKind::LineComment || kind == TokenKind::BlockComment;
+    }
+};
+
+struct TokenTable {
+    // sorted by begin, a preprocessor line comes before the comments and literals inside it
+    std::vector<Token> tokens;
+
+    // the first token of that kind starting in [pos, end), or nullptr
+    const Token* next(size_t pos, bool (*matches)(const Token&), size_t end = std::string_view::npos) const {
+        auto it = std::lower_bound(tokens.begin(), tokens.end(), pos, [](const Token& t, size_t p) { return t.begin < p; });
+        for (; it != tokens.end() && it->begin < end; ++it) {
+            if (matches(*it)) return &*it;
+        }
+        return nullptr;
+    }
+
+    const Token* next_comment(size_t pos, size_t end = std::string_view::npos) const {
+        return next(pos, [](const Token& t) { return t.is_comment(); }, end);
+    }
+
+    const Token* next_preprocessor(size_t pos, size_t end = std::string_view::npos) const {
+        return next(pos, [](const Token& t) { return t.kind == TokenKind::Preprocessor; }, end);
+    }
+};
+
+// the text between the comment markers; an unterminated block comment runs to the end of the source
+inline std::string_view comment_body(std::string_view src, const Token& comment) {
+    size_t begin = comment.begin + comment.open;
+    size_t end = comment.end - comment.close;
+    return src.substr(begin, end - begin);
+}
+
+enum class Language : uint8_t {
+    C, // C, C++ and anything else with // and /* */ comments
+    Python,
+    Shell,
+    Lua
+};
+
+// comment syntax by file extension, everything not listed is lexed as C
+struct LanguageExtension {
+    std::string_view extension;
+    Language language;
+};
+
+inline constexpr LanguageExtension languageExtensions[] = {
+    {".py", Language::Python},
+    {".pyi", Language::Python},
+    {".sh", Language::Shell},
+    {".bash", Language::Shell},
+    {".zsh", Language::Shell},
+    {".lua", Language::Lua},
+};
+
+inline Language language_for(std::string_view filename) {
+    size_t dot = filename.rfind('.');
+    if (dot == std::string_view::npos || filename.find_first_of("/\\", dot) != std::string_view::npos) {
+        return Language::C;
+    }
+    std::string_view extension = filename.substr(dot);
+    for (const LanguageExtension& entry : languageExtensions) {
+        if (entry.extension == extension) {
+            return entry.language;
+        }
+    }
+    return Language::C;
+}
+
+namespace lexer_detail {
+
+    // plain comparisons rather than std::isalnum, which is a call into the C library for every character
+    inline bool is_ident(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    inline bool is_space(char c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    // true if the newline at nl is spliced away by a backslash before it
+    inline bool continued(std::string_view src, size_t nl) {
+        if (nl > 0 && src[nl-1] == '\r') nl--;
+        return nl > 0 && src[nl-1] == '\\';
+    }
+
+    // the newline ending the logical line that pos is on, or the end of the source
+    inline size_t line_end(std::string_view src, size_t pos) {
+        const char* base = src.data();
+        const char* end = base + src.size();
+        while (true) {
+            size_t nl = simd::find_any(base + pos, end, '\n') - base;
+            if (nl >= src.size() || !continued(src, nl)) {
+                return nl;
+            }
+            pos = nl + 1;
+        }
+    }
+
+    // end of a string or character literal whose opening quote is just before pos
+    // an unterminated literal stops before the newline, like compilers do
+    inline size_t quoted_end(std::string_view src, size_t pos, char quote) {
+        const char* base = src.data();
+        const char* end = base + src.size();
+        while (true) {
+            pos = simd::find_any(base + pos, end, simd::ByteSet(quote, '\\', '\n')) - base;
+            if (pos >= src.size()) {
+                return src.size();
+            }
+            if (src[pos] == quote) {
+                return pos + 1;
+            }
+            if (src[pos] == '\n') {
+                return pos;
+            }
+            // an escape, which also covers a backslash-newline splice
+            pos += pos + 2 < src.size() && src[pos+1] == '\r' && src[pos+2] == '\n' ? 3 : 2;
+        }
+    }
+
+    // start of the raw string whose '"' is at quote (including its encoding prefix), or npos if it isn't one
+    inline size_t raw_string_begin(std::string_view src, size_t quote) {
+        if (quote == 0 || src[quote-1] != 'R') {
+            return std::string_view::npos;
+        }
+        size_t begin = quote - 1;
+        while (begin > 0 && is_ident(src[begin-1])) {
+            begin--;
+        }
+        std::string_view prefix = src.substr(begin, quote - 1 - begin);
+        if (prefix.empty() || prefix == "u8" || prefix == "u" || prefix == "U" || prefix == "L") {
+            return begin;
+        }
+        return std::string_view::npos;
+    }
+
+    // end of the raw string whose '"' is at quote, or npos if the delimiter is malformed
+    inline size_t raw_string_end(std::string_view src, size_t quote) {
+        size_t open = quote + 1;
+        while (open < src.size() && open - quote <= 17 && src[open] != '(') {
+            char c = src[open];
+            if (c == ')' || c == '\\' || c == '"' || std::isspace((unsigned char) c)) {
+                return std::string_view::npos;
+            }
+            open++;
+        }
+        if (open >= src.size() || src[open] != '(') {
+            return std::string_view::npos;
+        }
+        std::string closing = ")" + std::string(src.substr(quote + 1, open - quote - 1)) + "\"";
+        size_t close = src.find(closing, open + 1);
+        return close == std::string_view::npos ? src.size() : close + closing.size();
+    }
+
+    // a quote inside a number like 1'000'000 is a digit separator, not a character literal
+    inline bool digit_separator(std::string_view src, size_t quote) {
+        if (quote == 0 || !is_ident(src[quote-1])) {
+            return false;
+        }
+        size_t start = quote;
+        while (start > 0 && (is_ident(src[start-1]) || src[start-1] == '\'' || src[start-1] == '.')) {
+            start--;
+        }
+        return std::isdigit((unsigned char) src[start]) ||
+               (src[start] == '.' && start + 1 < quote && std::isdigit((unsigned char) src[start+1]));
+    }
+
+    // true if only spaces and tabs come before pos on its line
+    inline bool at_line_start(std::string_view src, size_t pos) {
+        while (pos > 0 && (src[pos-1] == ' ' || src[pos-1] == '\t')) {
+            pos--;
+        }
+        return pos == 0 || src[pos-1] == '\n';
+    }
+
+    // skips the header name of #include <...>, where "//" doesn't start a comment; pos is just after the '#'
+    inline size_t skip_header_name(std::string_view src, size_t pos) {
+        while (pos < src.size() && (src[pos] == ' ' || src[pos] == '\t')) pos++;
+        size_t name = pos;
+        while (pos < src.size() && is_ident(src[pos])) pos++;
+        std::string_view directive = src.substr(name, pos - name);
+        if (directive != "include" && directive != "include_next" && directive != "import") {
+            return pos;
+        }
+        while (pos < src.size() && (src[pos] == ' ' || src[pos] == '\t')) pos++;
+        if (pos >= src.size() || src[pos] != '<') {
+            return pos;
+        }
+        while (pos < src.size() && src[pos] != '>' && src[pos] != '\n') pos++;
+        return pos < src.size() && src[pos] == '>' ? pos + 1 : pos;
+    }
+
+    // end of a literal whose opening quote is just before pos that may span lines, or the end of the source
+    inline size_t multiline_quoted_end(std::string_view src, size_t pos, char quote, bool escapes) {
+        const char* base = src.data();
+        const char* end = base + src.size();
+        while (true) {
+            pos = simd::find_any(base + pos, end, escapes ? simd::ByteSet(quote, '\\') : simd::ByteSet(quote)) - base;
+            if (pos >= src.size()) {
+                return src.size();
+            }
+            if (src[pos] == quote) {
+                return pos + 1;
+            }
+            pos += 2;
+        }
+    }
+
+    // end of a Python triple-quoted string whose quotes start at pos, or the end of the source; sets closed
+    inline size_t triple_quoted_end(std::string_view src, size_t pos, bool& closed) {
+        const char quote = src[pos];
+        const char* base = src.data();
+        const char* end = base + src.size();
+        pos += 3;
+        while (true) {
+            pos = simd::find_any(base + pos, end, simd::ByteSet(quote, '\\')) - base;
+            if (pos >= src.size()) {
+                closed = false;
+                return src.size();
+            }
+            if (src[pos] == '\\') {
+                pos += 2;
+            } else if (pos + 2 < src.size() && src[pos+1] == quote && src[pos+2] == quote) {
+                closed = true;
+                return pos + 3;
+            } else {
+                pos++;
+            }
+        }
+    }
+
+    // level of the Lua long bracket like "[==[" at pos (the number of '='), or npos if there is none
+    inline size_t long_bracket(std::string_view src, size_t pos) {
+        if (pos >= src.size() || src[pos] != '[') {
+            return std::string_view::npos;
+        }
+        size_t level = 0;
+        while (pos + 1 + level < src.size() && src[pos + 1 + level] == '=') {
+            level++;
+        }
+        // the level has to fit a Token marker length
+        if (pos + 1 + level >= src.size() || src[pos + 1 + level] != '[' || level > 200) {
+            return std::string_view::npos;
+        }
+        return level;
+    }
+
+    // one past the "]==]" closing a long bracket of that level, searched from pos, or npos if it never closes
+    inline size_t long_bracket_end(std::string_view src, size_t pos, size_t level) {
+        std::string closing = "]" + std::string(level, '=') + "]";
+        size_t close = src.find(closing, pos);
+        return close == std::string_view::npos ? close : close + closing.size();
+    }
+
+    // a '#' only starts a shell comment at the start of a word, unlike in $# or ${#var}
+    inline bool shell_word_start(std::string_view src, size_t pos) {
+        if (pos == 0) {
+            return true;
+        }
+        char c = src[pos-1];
+        return std::isspace((unsigned char) c) || c == ';' || c == '&' || c == '|' || c == '(' || c == ')';
+    }
+
+} // namespace lexer_detail
+
+// lexes src from start on, which must not be inside a token
+inline TokenTable lex_source(std::string_view src, size_t start = 0) {
+    using namespace lexer_detail;
+    TokenTable table;
+    const char* base = src.data();
+    const char* end = base + src.size();
+    const size_t none = (size_t) -1;
+    size_t directive = none; // the preprocessor line we are in, as an index into table.tokens
+    size_t pos = start;
+    while (pos < src.size()) {
+        // jump to the next byte that can start something; inside a preprocessor line, look for its end instead of '#'
+        simd::ByteSet stops = directive == none ? simd::ByteSet('/', '"', '\'', '#') : simd::ByteSet('/', '"', '\'', '\n');
+        pos = simd::find_any(base + pos, end, stops) - base;
+        if (pos >= src.size()) {
+            break;
+        }
+        char c = src[pos];
+        char next = pos + 1 < src.size() ? src[pos+1] : '\0';
+        if (c == '/' && next == '/') {
+            size_t e = line_end(src, pos);
+            table.tokens.push_back({pos, e, TokenKind::LineComment, 2});
+            pos = e;
+        } else if (c == '/' && next == '*') {
+            size_t e = simd::find_pair(base + pos + 2, end, '*', '/') - base;
+            bool closed = e < src.size();
+            e = closed ? e + 2 : src.size();
+            table.tokens.push_back({pos, e, TokenKind::BlockComment, 2, (uint8_t) (closed ? 2 : 0)});
+            pos = e;
+        } else if (c == '"') {
+            size_t begin = raw_string_begin(src, pos);
+            size_t e = begin == none ? none : raw_string_end(src, pos);
+            if (e != none) {
+                table.tokens.push_back({begin, e, TokenKind::RawString});
+            } else {
+                e = quoted_end(src, pos + 1, '"');
+                table.tokens.push_back({pos, e, TokenKind::String});
+            }
+            pos = e;
+        } else if (c == '\'') {
+            if (digit_separator(src, pos)) {
+                pos++;
+            } else {
+                size_t e = quoted_end(src, pos + 1, '\'');
+                table.tokens.push_back({pos, e, TokenKind::Char});
+                pos = e;
+            }
+        } else if (c == '#') {
+            if (at_line_start(src, pos)) {
+                directive = table.tokens.size();
+                table.tokens.push_back({pos, src.size(), TokenKind::Preprocessor});
+                pos = skip_header_name(src, pos + 1);
+            } else {
+                pos++;
+            }
+        } else if (c == '\n') {
+            if (!continued(src, pos)) {
+                table.tokens[directive].end = pos;
+                directive = none;
+            }
+            pos++;
+        } else {
+            pos++;
+        }
+    }
+    return table;
+}
+
+// what lex_script looks for in each scripting language
+struct PythonSyntax {
+    static constexpr simd::ByteSet stops{'#', '"', '\''};
+    static constexpr bool hashComments = true;
+    static constexpr bool tripleQuotes = true;
+};
+
+struct ShellSyntax {
+    // a backslash outside quotes escapes the next byte, so \' and \# are plain text
+    static constexpr simd::ByteSet stops{'#', '"', '\'', '\\'};
+    static constexpr bool hashComments = true;
+    static constexpr bool tripleQuotes = false;
+};
+
+struct LuaSyntax {
+    static constexpr simd::ByteSet stops{'-', '"', '\'', '['};
+    static constexpr bool hashComments = false;
+    static constexpr bool tripleQuotes = false;
+};
+
+// lexes a language without a preprocessor: # comments in Python and shell, -- and --[[ ]] comments in Lua,
+// and their string literals. Python docstrings ("""...""" and '''...''') count as block comments, so they can hold
+// documentation too.
+template <typename Syntax>
+inline TokenTable lex_script(std::string_view src, size_t start = 0) {
+    using namespace lexer_detail;
+    constexpr bool shell = std::is_same_v<Syntax, ShellSyntax>;
+    constexpr bool lua = std::is_same_v<Syntax, LuaSyntax>;
+    const size_t none = std::string_view::npos;
+    TokenTable table;
+    const char* base = src.data();
+    const char* end = base + src.size();
+    size_t pos = start;
+    while (pos < src.size()) {
+        pos = simd::find_any(base + pos, end, Syntax::stops) - base;
+        if (pos >= src.size()) {
+            break;
+        }
+        char c = src[pos];
+        if (Syntax::hashComments && c == '#') {
+            if (shell && !shell_word_start(src, pos)) {
+                pos++;
+                continue;
+            }
+            size_t e = simd::find_any(base + pos, end, '\n') - base;
+            table.tokens.push_back({pos, e, TokenKind::LineComment, 1});
+            pos = e;
+        } else if (shell && c == '\\') {
+            pos += 2;
+        } else if (lua && c == '-') {
+            if (pos + 1 >= src.size() || src[pos+1] != '-') {
+                pos++;
+                continue;
+            }
+            size_t level = long_bracket(src, pos + 2);
+            size_t e = level == none ? none : long_bracket_end(src, pos + 4 + level, level);
+            if (level == none) {
+                e = simd::find_any(base + pos, end, '\n') - base;
+                table.tokens.push_back({pos, e, TokenKind::LineComment, 2});
+            } else if (e == none) {
+                e = src.size();
+                table.tokens.push_back({pos, e, TokenKind::BlockComment, (uint8_t) (4 + level)});
+            } else {
+                table.tokens.push_back({pos, e, TokenKind::BlockComment, (uint8_t) (4 + level), (uint8_t) (2 + level)});
+            }
+            pos = e;
+        } else if (lua && c == '[') {
+            size_t level = long_bracket(src, pos);
+            if (level == none) {
+                pos++;
+                continue;
+            }
+            size_t e = long_bracket_end(src, pos + 2 + level, level);
+            e = e == none ? src.size() : e;
+            table.tokens.push_back({pos, e, TokenKind::RawString});
+            pos = e;
+        } else if (Syntax::tripleQuotes && pos + 2 < src.size() && src[pos+1] == c && src[pos+2] == c) {
+            bool closed;
+            size_t e = triple_quoted_end(src, pos, closed);
+            table.tokens.push_back({pos, e, TokenKind::BlockComment, 3, (uint8_t) (closed ? 3 : 0)});
+            pos = e;
+        } else {
+            // shell strings may span lines and single quotes there have no escapes, the others end at the line
+            size_t e = shell ? multiline_quoted_end(src, pos + 1, c, c == '"') : quoted_end(src, pos + 1, c);
+            table.tokens.push_back({pos, e, TokenKind::String});
+            pos = e;
+        }
+    }
+    return table;
+}
+
+// lexes src with the scanner for its language
+inline TokenTable lex_source(std::string_view src, Language language, size_t start = 0) {
+    switch (language) {
+        case Language::Python: return lex_script<PythonSyntax>(src, start);
+        case Language::Shell: return lex_script<ShellSyntax>(src, start);
+        case Language::Lua: return lex_script<LuaSyntax>(src, start);
+        default: return lex_source(src, start);
+    }
+}
@@ -0,0 +1,50 @@
+// Line starts of a source, to turn byte offsets into line numbers.
+// The newlines are counted with SIMD first so the table is allocated once, then a lookup is a binary search.
+#pragma once
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+#include "simd.hpp"
+
+struct LineIndex {
+    std::vector<size_t> starts; // offset of the first byte of every line, empty until built
+    size_t size = 0; // size of the text it was built for
+    size_t firstLine = 1; // number of the line the text starts on, a streaming window starts further down
+
+    void build(std::string_view text, size_t first = 1) {
+        const char* base = text.data();
+        const char* end = base + text.size();
+        starts.clear();
+        starts.reserve(simd::count_byte(base, end, '\n') + 1);
+        starts.push_back(0);
+        for (const char* p = base; (p = simd::find_any(p, end, '\n')) != end; p++) {
+            starts.push_back(p + 1 - base);
+        }
+        size = text.size();
+        firstLine = first;
+    }
+
+    bool built() const {
+        return !starts.empty();
+    }
+
+    void clear() {
+        starts.clear();
+    }
+
+    // index of the line containing offset, counting from 0 at the start of the text
+    size_t line_of(size_t offset) const {
+        return std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin() - 1;
+    }
+
+    // the number of the line containing offset, as an editor shows it
+    size_t line_number(size_t offset) const {
+        return firstLine + line_of(offset);
+    }
+
+    // where line ends: its newline, or the end of the text for the last one
+    size_t line_end(size_t line) const {
+        return line + 1 < starts.size() ? starts[line + 1] - 1 : size;
+    }
+};
@@ -0,0 +1,115 @@
+// Read-only view of a whole source file for PROCESS_SOURCES.
+// Regular files are mapped with mmap and never copied; pipes, FIFOs, files in /proc (which report a size of 0) and
+// anything mmap refuses are read into a buffer instead. On Windows everything is read into the buffer.
+// A mapped file that is truncated by someone else while we look at it raises SIGBUS, like with any mmap reader.
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    ~MappedFile() {
+        unmap();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // maps or reads the file, false with last_error() set if it can't be opened
+    bool open(const std::filesystem::path& path) {
+        unmap();
+        buffer.clear();
+        error.clear();
+#ifdef _WIN32
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            error = "could not open file";
+            return false;
+        }
+        buffer.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return true;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            error = std::strerror(errno);
+            return false;
+        }
+        struct stat st{};
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* p = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                // the scanner reads front to back once, so let the kernel read ahead aggressively
+                madvise(p, (size_t) st.st_size, MADV_SEQUENTIAL);
+                map = p;
+                mapSize = (size_t) st.st_size;
+                ::close(fd);
+                return true;
+            }
+        }
+        // not mappable, read until EOF since the size may be unknown
+        char chunk[64 * 1024];
+        while (true) {
+            ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                error = std::strerror(errno);
+                ::close(fd);
+                return false;
+            }
+            if (n == 0) {
+                break;
+            }
+            buffer.append(chunk, (size_t) n);
+        }
+        ::close(fd);
+        return true;
+#endif
+    }
+
+    std::string_view view() const {
+        if (map) {
+            return {(const char*) map, mapSize};
+        }
+        return buffer;
+    }
+
+    bool mapped() const {
+        return map != nullptr;
+    }
+
+    const std::string& last_error() const {
+        return error;
+    }
+
+private:
+    void unmap() {
+#ifndef _WIN32
+        if (map) {
+            munmap(map, mapSize);
+        }
+#endif
+        map = nullptr;
+        mapSize = 0;
+    }
+
+    void* map = nullptr;
+    size_t mapSize = 0;
+    std::string buffer; // the contents when the file isn't mapped
+    std::string error;
+};
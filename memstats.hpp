@@ -0,0 +1,179 @@
+// Allocation and memory accounting for --mem.
+// The allocation counters are filled in by a replacement operator new, which is defined in the one
+// translation unit of each executable that defines DOCGEN_ALLOC_HOOKS before including this header.
+// It only counts once enabled is set, so a run without --mem pays one predictable branch per allocation.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+struct AllocCounters {
+    std::atomic<bool> enabled{false};
+    std::atomic<size_t> count{0};
+    std::atomic<size_t> bytes{0};
+};
+
+inline AllocCounters allocCounters;
+
+#ifdef DOCGEN_ALLOC_HOOKS
+// none of these are inlined, or GCC sees the malloc() and free() behind them and warns about a mismatch
+// (-Wmismatched-new-delete)
+__attribute__((noinline)) void* operator new(size_t size) {
+    if (allocCounters.enabled.load(std::memory_order_relaxed)) {
+        allocCounters.count.fetch_add(1, std::memory_order_relaxed);
+        allocCounters.bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+#endif
+
+// highest resident set size of the process so far, in bytes (0 where unsupported)
+inline size_t peak_rss() {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return (size_t) usage.ru_maxrss;
+#else
+    return (size_t) usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// resident set size of the process right now, in bytes (0 where unsupported)
+inline size_t current_rss() {
+#ifdef __linux__
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) {
+        return 0;
+    }
+    long pages = 0, resident = 0;
+    int n = std::fscanf(f, "%ld %ld", &pages, &resident);
+    std::fclose(f);
+    return n == 2 ? (size_t) resident * (size_t) sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+// the copies that docgen makes of source text, by reason
+struct MemoryStats {
+    struct CopyStats {
+        size_t count = 0;
+        size_t bytes = 0;
+
+        void add(size_t n) {
+            count++;
+            bytes += n;
+        }
+    };
+
+    struct AllocStats {
+        size_t count = 0;
+        size_t bytes = 0;
+    };
+
+    CopyStats sourceReads;    // files PROCESS_SOURCES couldn't map and read into a buffer (pipes, special files)
+    CopyStats sourceMaps;     // files PROCESS_SOURCES mapped, which are not copied
+    CopyStats pluginCopies;   // the rest of the file after the comment, handed to a plugin command
+    // allocations made while the commands of a doc comment wrote to each section, "" being the main one
+    std::unordered_map<std::string, AllocStats> sectionAllocs;
+    size_t markCount = 0;
+    size_t markBytes = 0;
+    size_t topN = 10;
+
+    // starts counting the allocations to charge to a section
+    void mark() {
+        markCount = allocCounters.count.load(std::memory_order_relaxed);
+        markBytes = allocCounters.bytes.load(std::memory_order_relaxed);
+    }
+
+    // charges the allocations since the last mark to section, and marks again
+    void charge(const std::string& section) {
+        size_t count = markCount, bytes = markBytes;
+        mark();
+        AllocStats& stats = sectionAllocs[section];
+        stats.count += markCount - count;
+        stats.bytes += markBytes - bytes;
+    }
+
+    void report(std::ostream& out, const std::unordered_map<std::string, std::string>& sections,
+                const std::string& mainSection, const std::string& output) const {
+        auto mb = [](size_t bytes) { return bytes / 1e6; };
+        out << std::fixed << std::setprecision(2);
+        out << "\nMemory: peak RSS " << mb(peak_rss()) << " MB, current RSS " << mb(current_rss()) << " MB, "
+            << allocCounters.count.load() << " allocations, " << mb(allocCounters.bytes.load()) << " MB allocated\n";
+
+        out << std::left << std::setw(24) << "copies" << std::right << std::setw(12) << "count" << std::setw(14) << "MB" << '\n';
+        auto copyRow = [&](const char* name, const CopyStats& c) {
+            out << std::left << std::setw(24) << name << std::right << std::setw(12) << c.count << std::setw(14) << mb(c.bytes) << '\n';
+        };
+        copyRow("source reads", sourceReads);
+        copyRow("source maps (no copy)", sourceMaps);
+        copyRow("plugin copies", pluginCopies);
+
+        struct Buffer {
+            std::string name;
+            const std::string* buffer;
+            const AllocStats* allocs; // nullptr if nothing writes to it while commands run
+        };
+        auto allocsOf = [this](const std::string& section) -> const AllocStats* {
+            auto it = sectionAllocs.find(section);
+            return it == sectionAllocs.end() ? nullptr : &it->second;
+        };
+        std::vector<Buffer> buffers;
+        buffers.push_back({"(main section)", &mainSection, allocsOf("")});
+        buffers.push_back({"(output)", &output, nullptr});
+        size_t sectionBytes = 0;
+        for (const auto& [name, buffer] : sections) {
+            buffers.push_back({name, &buffer, allocsOf(name)});
+            sectionBytes += buffer.capacity();
+        }
+        std::sort(buffers.begin(), buffers.end(), [](const Buffer& a, const Buffer& b) {
+            return a.buffer->capacity() > b.buffer->capacity();
+        });
+        if (buffers.size() > topN) {
+            buffers.resize(topN);
+        }
+        // the sizes are the buffers at the end of the run, the allocations everything the commands writing to them allocated
+        out << '\n' << sections.size() << " sections, " << mb(sectionBytes) << " MB of section buffers\n";
+        out << std::left << std::setw(40) << "buffer" << std::right << std::setw(14) << "size MB" << std::setw(14) << "capacity MB"
+            << std::setw(12) << "allocs" << std::setw(12) << "alloc MB" << '\n';
+        for (const Buffer& b : buffers) {
+            out << std::left << std::setw(40) << b.name << std::right << std::setw(14) << mb(b.buffer->size())
+                << std::setw(14) << mb(b.buffer->capacity());
+            if (b.allocs) {
+                out << std::setw(12) << b.allocs->count << std::setw(12) << mb(b.allocs->bytes);
+            } else {
+                out << std::setw(12) << "-" << std::setw(12) << "-";
+            }
+            out << '\n';
+        }
+    }
+};
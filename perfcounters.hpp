@@ -0,0 +1,191 @@
+// Hardware counters around the scanner and simplify_md for --perf, read with Linux perf_event_open.
+// Every counter is opened on its own, so whatever the kernel allows still gets reported: in VMs and containers the
+// hardware counters are often missing, and perf_event_paranoid can forbid all of them. Elsewhere this is a no-op.
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum class PerfRegion {
+    ProcessSource,
+    SimplifyMd,
+    Count
+};
+
+inline const char* perf_region_name(PerfRegion region) {
+    switch (region) {
+        case PerfRegion::ProcessSource: return "process_source";
+        case PerfRegion::SimplifyMd: return "simplify_md";
+        default: return "?";
+    }
+}
+
+struct PerfCounters {
+    enum Counter {
+        TaskClock,
+        Cycles,
+        Instructions,
+        BranchMisses,
+        CacheMisses,
+        CounterCount
+    };
+
+    struct Region {
+        uint64_t totals[CounterCount] = {};
+        uint64_t start[CounterCount] = {};
+        size_t bytes = 0;
+        size_t calls = 0;
+        int depth = 0; // a region entered again while it is running is only counted by the outermost call
+    };
+
+    int fds[CounterCount] = {-1, -1, -1, -1, -1};
+    std::string errors[CounterCount];
+    Region regions[(size_t) PerfRegion::Count];
+
+    PerfCounters() {
+#ifdef __linux__
+        const uint32_t types[CounterCount] = {PERF_TYPE_SOFTWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                              PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE};
+        const uint64_t configs[CounterCount] = {PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_HW_CPU_CYCLES,
+                                                PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+                                                PERF_COUNT_HW_CACHE_MISSES};
+        for (int i = 0; i < CounterCount; i++) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = types[i];
+            attr.config = configs[i];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fds[i] < 0) {
+                errors[i] = std::strerror(errno);
+            }
+        }
+#else
+        for (std::string& error : errors) {
+            error = "perf_event_open is Linux only";
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    static const char* counter_name(int counter) {
+        switch (counter) {
+            case TaskClock: return "task-clock";
+            case Cycles: return "cycles";
+            case Instructions: return "instructions";
+            case BranchMisses: return "branch-misses";
+            case CacheMisses: return "cache-misses";
+            default: return "?";
+        }
+    }
+
+    // current value, scaled up if the kernel had to multiplex the counter
+    uint64_t read_counter(int counter) const {
+#ifdef __linux__
+        uint64_t values[3] = {};
+        if (fds[counter] < 0 || ::read(fds[counter], values, sizeof(values)) != sizeof(values)) {
+            return 0;
+        }
+        if (values[2] == 0) {
+            return 0;
+        }
+        return values[2] < values[1] ? (uint64_t) ((double) values[0] * values[1] / values[2]) : values[0];
+#else
+        return 0;
+#endif
+    }
+
+    void begin(PerfRegion region) {
+        Region& r = regions[(size_t) region];
+        if (r.depth++ > 0) {
+            return;
+        }
+        for (int i = 0; i < CounterCount; i++) {
+            r.start[i] = read_counter(i);
+        }
+    }
+
+    void end(PerfRegion region, size_t bytes) {
+        Region& r = regions[(size_t) region];
+        if (--r.depth > 0) {
+            return;
+        }
+        for (int i = 0; i < CounterCount; i++) {
+            r.totals[i] += read_counter(i) - r.start[i];
+        }
+        r.bytes += bytes;
+        r.calls++;
+    }
+
+    void report(std::ostream& out) const {
+        out << "\nPerf counters (user space only)\n";
+        for (int i = 0; i < CounterCount; i++) {
+            if (fds[i] < 0) {
+                out << "  " << counter_name(i) << " not available: " << errors[i] << '\n';
+            }
+        }
+        out << std::left << std::setw(18) << "region" << std::right << std::setw(10) << "calls" << std::setw(14) << "bytes"
+            << std::setw(12) << "task ms" << std::setw(12) << "cycles/B" << std::setw(8) << "IPC"
+            << std::setw(16) << "br-miss/KB" << std::setw(16) << "cache-miss/KB" << '\n';
+        for (size_t i = 0; i < (size_t) PerfRegion::Count; i++) {
+            const Region& r = regions[i];
+            double kb = r.bytes / 1024.0;
+            auto cell = [&](int counter, double value) {
+                if (fds[counter] < 0) {
+                    out << "n/a";
+                } else {
+                    out << value;
+                }
+            };
+            out << std::left << std::setw(18) << perf_region_name((PerfRegion) i) << std::right << std::setw(10) << r.calls
+                << std::setw(14) << r.bytes << std::fixed << std::setprecision(2);
+            out << std::setw(12); cell(TaskClock, r.totals[TaskClock] / 1e6);
+            out << std::setw(12); cell(Cycles, r.bytes ? (double) r.totals[Cycles] / r.bytes : 0);
+            out << std::setw(8); cell(fds[Instructions] < 0 ? Instructions : Cycles,
+                                      r.totals[Cycles] ? (double) r.totals[Instructions] / r.totals[Cycles] : 0);
+            out << std::setw(16); cell(BranchMisses, kb > 0 ? r.totals[BranchMisses] / kb : 0);
+            out << std::setw(16); cell(CacheMisses, kb > 0 ? r.totals[CacheMisses] / kb : 0);
+            out << '\n';
+        }
+    }
+};
+
+// counts a region for as long as it is in scope, does nothing when --perf is off
+struct PerfScope {
+    PerfCounters* counters;
+    PerfRegion region;
+    size_t bytes;
+
+    PerfScope(PerfCounters* counters, PerfRegion region, size_t bytes) : counters(counters), region(region), bytes(bytes) {
+        if (counters) counters->begin(region);
+    }
+
+    ~PerfScope() {
+        if (counters) counters->end(region, bytes);
+    }
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+};
@@ -0,0 +1,191 @@
+// Per-phase wall time accounting for --profile.
+// Phases nest (an alias expansion scans comments inside command execution), so each phase records its own
+// time only: starting a nested phase pauses the outer one. That way the phase times add up to the wall time.
+// With --mem, allocations and peak RSS growth are attributed to phases the same way.
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "memstats.hpp"
+
+enum class Phase {
+    ReadDocgen,
+    ParseDocgen,
+    CompileCommands,
+    Glob,
+    ReadSources,
+    ScanComments,
+    RunCommands,
+    SimplifyMd,
+    LinkReferences,
+    WriteOutput,
+    Count
+};
+
+inline const char* phase_name(Phase phase) {
+    switch (phase) {
+        case Phase::ReadDocgen: return "read .docgen";
+        case Phase::ParseDocgen: return "parse .docgen";
+        case Phase::CompileCommands: return "NEW_COMMAND compile";
+        case Phase::Glob: return "glob";
+        case Phase::ReadSources: return "read sources";
+        case Phase::ScanComments: return "scan comments";
+        case Phase::RunCommands: return "run commands";
+        case Phase::SimplifyMd: return "simplify_md";
+        case Phase::LinkReferences: return "link @REF";
+        case Phase::WriteOutput: return "write output";
+        default: return "?";
+    }
+}
+
+struct Profiler {
+    using clock = std::chrono::steady_clock;
+
+    struct PhaseStats {
+        double seconds = 0;
+        size_t bytes = 0;
+        size_t calls = 0;
+        size_t allocs = 0;
+        size_t allocBytes = 0;
+        size_t peakGrowth = 0;
+    };
+
+    // a single source file, or a single PROCESS_SOURCES directive
+    struct ItemStats {
+        std::string name;
+        double seconds;
+        size_t bytes;
+        size_t files;
+    };
+
+    size_t topN = 10;
+    bool trackMemory = false;
+    PhaseStats phases[(size_t) Phase::Count];
+    std::vector<ItemStats> files;
+    std::vector<ItemStats> directives;
+    std::vector<Phase> stack;
+    clock::time_point lastSwitch;
+    clock::time_point startTime = clock::now();
+    size_t lastAllocs = 0;
+    size_t lastAllocBytes = 0;
+    size_t lastPeak = 0;
+
+    void begin(Phase phase, size_t bytes) {
+        account();
+        stack.push_back(phase);
+        phases[(size_t) phase].bytes += bytes;
+        phases[(size_t) phase].calls++;
+    }
+
+    void end() {
+        account();
+        stack.pop_back();
+    }
+
+    // charges everything since the last phase switch to the running phase
+    void account() {
+        clock::time_point now = clock::now();
+        if (!stack.empty()) {
+            phases[(size_t) stack.back()].seconds += std::chrono::duration<double>(now - lastSwitch).count();
+        }
+        lastSwitch = now;
+        if (!trackMemory) {
+            return;
+        }
+        size_t allocs = allocCounters.count.load(std::memory_order_relaxed);
+        size_t allocBytes = allocCounters.bytes.load(std::memory_order_relaxed);
+        size_t peak = peak_rss();
+        if (!stack.empty()) {
+            PhaseStats& p = phases[(size_t) stack.back()];
+            p.allocs += allocs - lastAllocs;
+            p.allocBytes += allocBytes - lastAllocBytes;
+            p.peakGrowth += peak - lastPeak;
+        }
+        lastAllocs = allocs;
+        lastAllocBytes = allocBytes;
+        lastPeak = peak;
+    }
+
+    void report(std::ostream& out) const {
+        double wall = std::chrono::duration<double>(clock::now() - startTime).count();
+        auto mbps = [](size_t bytes, double seconds) {
+            return seconds > 0 ? bytes / seconds / 1e6 : 0.0;
+        };
+
+        std::vector<size_t> order;
+        for (size_t i = 0; i < (size_t) Phase::Count; i++) {
+            if (phases[i].calls) order.push_back(i);
+        }
+        std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            return phases[a].seconds > phases[b].seconds;
+        });
+        out << "\nProfile (wall time " << std::fixed << std::setprecision(2) << wall * 1e3 << " ms)\n";
+        out << std::left << std::setw(24) << "phase" << std::right << std::setw(10) << "calls" << std::setw(12) << "ms"
+            << std::setw(8) << "%" << std::setw(14) << "bytes" << std::setw(10) << "MB/s";
+        if (trackMemory) {
+            out << std::setw(12) << "allocs" << std::setw(12) << "alloc MB" << std::setw(12) << "peak +MB";
+        }
+        out << '\n';
+        for (size_t i : order) {
+            const PhaseStats& p = phases[i];
+            out << std::left << std::setw(24) << phase_name((Phase) i) << std::right << std::setw(10) << p.calls
+                << std::setw(12) << std::setprecision(2) << p.seconds * 1e3
+                << std::setw(8) << std::setprecision(1) << (wall > 0 ? p.seconds * 100 / wall : 0)
+                << std::setw(14) << p.bytes << std::setw(10) << std::setprecision(2) << mbps(p.bytes, p.seconds);
+            if (trackMemory) {
+                out << std::setw(12) << p.allocs << std::setw(12) << p.allocBytes / 1e6 << std::setw(12) << p.peakGrowth / 1e6;
+            }
+            out << '\n';
+        }
+        out << "Total bytes scanned: " << phases[(size_t) Phase::ScanComments].bytes << '\n';
+
+        report_items(out, "PROCESS_SOURCES", directives, directives.size());
+        report_items(out, "slowest files", files, topN);
+    }
+
+private:
+    static void report_items(std::ostream& out, const std::string& title, std::vector<ItemStats> items, size_t limit) {
+        if (items.empty()) {
+            return;
+        }
+        std::sort(items.begin(), items.end(), [](const ItemStats& a, const ItemStats& b) {
+            return a.seconds > b.seconds;
+        });
+        if (items.size() > limit) {
+            items.resize(limit);
+        }
+        out << '\n' << std::left << std::setw(48) << title << std::right << std::setw(8) << "files"
+            << std::setw(12) << "ms" << std::setw(14) << "bytes" << std::setw(10) << "MB/s" << '\n';
+        for (const ItemStats& item : items) {
+            out << std::left << std::setw(48) << item.name << std::right << std::setw(8) << item.files
+                << std::setw(12) << std::setprecision(2) << item.seconds * 1e3 << std::setw(14) << item.bytes
+                << std::setw(10) << (item.seconds > 0 ? item.bytes / item.seconds / 1e6 : 0.0) << '\n';
+        }
+    }
+};
+
+// times a phase for as long as it is in scope, does nothing when profiling is off
+struct ProfileScope {
+    Profiler* profiler;
+
+    ProfileScope(Profiler* profiler, Phase phase, size_t bytes = 0) : profiler(profiler) {
+        if (profiler) profiler->begin(phase, bytes);
+    }
+
+    ~ProfileScope() {
+        stop();
+    }
+
+    // ends the phase early
+    void stop() {
+        if (profiler) profiler->end();
+        profiler = nullptr;
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
@@ -0,0 +1,209 @@
+// Vectorized byte searches and counts used by the lexer and the line index.
+// x86 gets SSE2 (always there on x86-64) and an AVX2 version picked at runtime, everything else a scalar loop.
+// None of them read outside [begin, end), so they are safe on buffers without a terminator.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DOCGEN_SIMD_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define DOCGEN_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace simd {
+
+    // up to 4 bytes to search for at once, unused slots repeat the last byte
+    struct ByteSet {
+        char bytes[4];
+
+        constexpr ByteSet(char a) : bytes{a, a, a, a} {}
+        constexpr ByteSet(char a, char b) : bytes{a, b, b, b} {}
+        constexpr ByteSet(char a, char b, char c) : bytes{a, b, c, c} {}
+        constexpr ByteSet(char a, char b, char c, char d) : bytes{a, b, c, d} {}
+
+        constexpr bool contains(char c) const {
+            return c == bytes[0] || c == bytes[1] || c == bytes[2] || c == bytes[3];
+        }
+    };
+
+    namespace detail {
+
+        inline const char* find_any_scalar(const char* p, const char* end, ByteSet set) {
+            while (p < end && !set.contains(*p)) {
+                p++;
+            }
+            return p;
+        }
+
+        inline const char* find_pair_scalar(const char* p, const char* end, char a, char b) {
+            while (p + 1 < end && !(p[0] == a && p[1] == b)) {
+                p++;
+            }
+            return p + 1 < end ? p : end;
+        }
+
+        inline size_t count_byte_scalar(const char* p, const char* end, char c) {
+            size_t n = 0;
+            for (; p < end; p++) {
+                n += *p == c;
+            }
+            return n;
+        }
+
+#ifdef DOCGEN_SIMD_SSE2
+        inline int popcount(unsigned mask) {
+#ifdef __GNUC__
+            return __builtin_popcount(mask);
+#else
+            return (int) __popcnt(mask);
+#endif
+        }
+
+        inline int lowest_bit(unsigned mask) {
+#ifdef __GNUC__
+            return __builtin_ctz(mask);
+#else
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return (int) index;
+#endif
+        }
+
+        inline const char* find_any_sse2(const char* p, const char* end, ByteSet set) {
+            const __m128i s0 = _mm_set1_epi8(set.bytes[0]);
+            const __m128i s1 = _mm_set1_epi8(set.bytes[1]);
+            const __m128i s2 = _mm_set1_epi8(set.bytes[2]);
+            const __m128i s3 = _mm_set1_epi8(set.bytes[3]);
+            for (; end - p >= 16; p += 16) {
+                __m128i v = _mm_loadu_si128((const __m128i*) p);
+                __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, s0), _mm_cmpeq_epi8(v, s1)),
+                                           _mm_or_si128(_mm_cmpeq_epi8(v, s2), _mm_cmpeq_epi8(v, s3)));
+                unsigned mask = (unsigned) _mm_movemask_epi8(hit);
+                if (mask) {
+                    return p + lowest_bit(mask);
+                }
+            }
+            return find_any_scalar(p, end, set);
+        }
+
+        inline const char* find_pair_sse2(const char* p, const char* end, char a, char b) {
+            const __m128i va = _mm_set1_epi8(a);
+            const __m128i vb = _mm_set1_epi8(b);
+            // compare 16 positions against a and the 16 bytes after each of them against b
+            for (; end - p >= 17; p += 16) {
+                __m128i first = _mm_loadu_si128((const __m128i*) p);
+                __m128i second = _mm_loadu_si128((const __m128i*) (p + 1));
+                unsigned mask = (unsigned) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, va), _mm_cmpeq_epi8(second, vb)));
+                if (mask) {
+                    return p + lowest_bit(mask);
+                }
+            }
+            return find_pair_scalar(p, end, a, b);
+        }
+
+        inline size_t count_byte_sse2(const char* p, const char* end, char c) {
+            const __m128i vc = _mm_set1_epi8(c);
+            size_t n = 0;
+            for (; end - p >= 16; p += 16) {
+                __m128i v = _mm_loadu_si128((const __m128i*) p);
+                n += popcount((unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(v, vc)));
+            }
+            return n + count_byte_scalar(p, end, c);
+        }
+#endif
+
+#ifdef DOCGEN_SIMD_AVX2
+        __attribute__((target("avx2")))
+        inline const char* find_any_avx2(const char* p, const char* end, ByteSet set) {
+            const __m256i s0 = _mm256_set1_epi8(set.bytes[0]);
+            const __m256i s1 = _mm256_set1_epi8(set.bytes[1]);
+            const __m256i s2 = _mm256_set1_epi8(set.bytes[2]);
+            const __m256i s3 = _mm256_set1_epi8(set.bytes[3]);
+            for (; end - p >= 32; p += 32) {
+                __m256i v = _mm256_loadu_si256((const __m256i*) p);
+                __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, s0), _mm256_cmpeq_epi8(v, s1)),
+                                              _mm256_or_si256(_mm256_cmpeq_epi8(v, s2), _mm256_cmpeq_epi8(v, s3)));
+                unsigned mask = (unsigned) _mm256_movemask_epi8(hit);
+                if (mask) {
+                    return p + __builtin_ctz(mask);
+                }
+            }
+            return find_any_sse2(p, end, set);
+        }
+
+        __attribute__((target("avx2")))
+        inline const char* find_pair_avx2(const char* p, const char* end, char a, char b) {
+            const __m256i va = _mm256_set1_epi8(a);
+            const __m256i vb = _mm256_set1_epi8(b);
+            for (; end - p >= 33; p += 32) {
+                __m256i first = _mm256_loadu_si256((const __m256i*) p);
+                __m256i second = _mm256_loadu_si256((const __m256i*) (p + 1));
+                unsigned mask = (unsigned) _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, va), _mm256_cmpeq_epi8(second, vb)));
+                if (mask) {
+                    return p + __builtin_ctz(mask);
+                }
+            }
+            return find_pair_sse2(p, end, a, b);
+        }
+
+        __attribute__((target("avx2,popcnt")))
+        inline size_t count_byte_avx2(const char* p, const char* end, char c) {
+            const __m256i vc = _mm256_set1_epi8(c);
+            size_t n = 0;
+            for (; end - p >= 32; p += 32) {
+                __m256i v = _mm256_loadu_si256((const __m256i*) p);
+                n += __builtin_popcount((unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vc)));
+            }
+            return n + count_byte_sse2(p, end, c);
+        }
+
+        inline bool has_avx2() {
+            static const bool avx2 = __builtin_cpu_supports("avx2");
+            return avx2;
+        }
+#endif
+
+    } // namespace detail
+
+    // first byte in [begin, end) that is in set, or end
+    inline const char* find_any(const char* begin, const char* end, ByteSet set) {
+#if defined(DOCGEN_SIMD_AVX2)
+        if (detail::has_avx2()) return detail::find_any_avx2(begin, end, set);
+        return detail::find_any_sse2(begin, end, set);
+#elif defined(DOCGEN_SIMD_SSE2)
+        return detail::find_any_sse2(begin, end, set);
+#else
+        return detail::find_any_scalar(begin, end, set);
+#endif
+    }
+
+    // first position p in [begin, end) with p[0] == a and p[1] == b (both inside the range), or end
+    inline const char* find_pair(const char* begin, const char* end, char a, char b) {
+#if defined(DOCGEN_SIMD_AVX2)
+        if (detail::has_avx2()) return detail::find_pair_avx2(begin, end, a, b);
+        return detail::find_pair_sse2(begin, end, a, b);
+#elif defined(DOCGEN_SIMD_SSE2)
+        return detail::find_pair_sse2(begin, end, a, b);
+#else
+        return detail::find_pair_scalar(begin, end, a, b);
+#endif
+    }
+
+    // how many bytes in [begin, end) are c, for counting lines
+    inline size_t count_byte(const char* begin, const char* end, char c) {
+#if defined(DOCGEN_SIMD_AVX2)
+        if (detail::has_avx2()) return detail::count_byte_avx2(begin, end, c);
+        return detail::count_byte_sse2(begin, end, c);
+#elif defined(DOCGEN_SIMD_SSE2)
+        return detail::count_byte_sse2(begin, end, c);
+#else
+        return detail::count_byte_scalar(begin, end, c);
+#endif
+    }
+
+} // namespace simd
@@ -0,0 +1,119 @@
+// Per-command call counts, latency and output size for --stats.
+// Covers every source command: built-ins, NEW_ALIAS aliases and NEW_COMMAND plugins.
+// Times are inclusive, so an alias also counts the time of the commands it expands to.
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// log-scale latency histogram: 4 buckets per power of two, from 1ns to about 70s
+struct LatencyHistogram {
+    static constexpr size_t bucketsPerOctave = 4;
+    static constexpr size_t bucketCount = 36 * bucketsPerOctave;
+    uint64_t buckets[bucketCount] = {};
+    uint64_t count = 0;
+
+    static size_t bucket_of(double ns) {
+        if (ns < 1) {
+            return 0;
+        }
+        size_t b = (size_t) (std::log2(ns) * bucketsPerOctave);
+        return std::min(b, bucketCount - 1);
+    }
+
+    void add(double ns) {
+        buckets[bucket_of(ns)]++;
+        count++;
+    }
+
+    // upper edge of the bucket holding the given quantile, in ns
+    double quantile(double q) const {
+        uint64_t target = (uint64_t) std::ceil(q * count);
+        uint64_t seen = 0;
+        for (size_t b = 0; b < bucketCount; b++) {
+            seen += buckets[b];
+            if (seen >= target && seen > 0) {
+                return std::exp2((double) (b + 1) / bucketsPerOctave);
+            }
+        }
+        return 0;
+    }
+};
+
+struct CommandStats {
+    using clock = std::chrono::steady_clock;
+
+    struct Record {
+        const char* kind = "builtin";
+        uint64_t calls = 0;
+        double seconds = 0;
+        uint64_t bytesOut = 0;
+        LatencyHistogram latency;
+    };
+
+    std::unordered_map<std::string, Record> commands;
+    clock::time_point startTime = clock::now();
+
+    void report(std::ostream& out) const {
+        double wall = std::chrono::duration<double>(clock::now() - startTime).count();
+        std::vector<std::pair<std::string, const Record*>> order;
+        for (const auto& [name, record] : commands) {
+            order.emplace_back(name, &record);
+        }
+        std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+            return a.second->seconds > b.second->seconds;
+        });
+        out << "\nCommand stats (inclusive times, wall time " << std::fixed << std::setprecision(2) << wall * 1e3 << " ms)\n";
+        out << std::left << std::setw(24) << "command" << std::setw(9) << "kind" << std::right << std::setw(10) << "calls"
+            << std::setw(12) << "total ms" << std::setw(8) << "%" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us"
+            << std::setw(14) << "bytes out" << '\n';
+        for (const auto& [name, r] : order) {
+            out << std::left << std::setw(24) << name << std::setw(9) << r->kind << std::right << std::setw(10) << r->calls
+                << std::setw(12) << std::setprecision(2) << r->seconds * 1e3
+                << std::setw(8) << std::setprecision(1) << (wall > 0 ? r->seconds * 100 / wall : 0)
+                << std::setw(12) << std::setprecision(2) << r->latency.quantile(0.5) / 1e3
+                << std::setw(12) << r->latency.quantile(0.99) / 1e3
+                << std::setw(14) << r->bytesOut << '\n';
+        }
+    }
+};
+
+// records one command invocation when it goes out of scope, does nothing when stats are off
+// emitted points at the running count of bytes written to the docs
+struct CommandScope {
+    CommandStats* stats;
+    std::string_view name;
+    const size_t& emitted;
+    size_t emittedStart;
+    CommandStats::clock::time_point start;
+    const char* kind = "builtin";
+
+    CommandScope(CommandStats* stats, std::string_view name, const size_t& emitted)
+            : stats(stats), name(name), emitted(emitted), emittedStart(emitted) {
+        if (stats) start = CommandStats::clock::now();
+    }
+
+    ~CommandScope() {
+        if (!stats) {
+            return;
+        }
+        double seconds = std::chrono::duration<double>(CommandStats::clock::now() - start).count();
+        CommandStats::Record& r = stats->commands[std::string(name)];
+        r.kind = kind;
+        r.calls++;
+        r.seconds += seconds;
+        r.bytesOut += emitted - emittedStart;
+        r.latency.add(seconds * 1e9);
+    }
+
+    CommandScope(const CommandScope&) = delete;
+    CommandScope& operator=(const CommandScope&) = delete;
+};
@@ -0,0 +1,237 @@
+// The symbols documented across every processed source, and the @REF links to them.
+// While sources are processed, each doc comment reserves a symbol and leaves a marker where its documentation starts,
+// and each @REF leaves a marker of its own. The symbol is named once the comment's commands parse the declaration it
+// documents; nothing is parsed for it otherwise. Once all output is assembled, link() hashes the names, resolves every
+// reference with one lookup and replaces the markers in one pass. The hash index is only built when there is a
+// reference to resolve, so registering a symbol is just an append. Anchors are only written for symbols something
+// links to, so the output of a project without @REF is the same as without the table.
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "simd.hpp"
+
+struct SymbolTable {
+    // markers are "\x01A<id>\x02" for where symbol id is documented and "\x01R<id>\x02" for reference id
+    static constexpr char markerBegin = '\x01';
+    static constexpr char markerEnd = '\x02';
+
+    struct Reference {
+        std::string target; // the name as written, like Foo::bar
+        std::string text; // the link text, the target unless given
+        std::string where; // "path:line" of the @REF, for the warning if it doesn't resolve
+    };
+
+    struct Symbol {
+        std::string name; // qualified, like Foo::bar, or empty until it is named
+        size_t unqualified = 0; // where the name without its class starts
+    };
+
+    std::vector<Symbol> symbols; // by id
+    std::vector<Reference> references;
+    std::unordered_map<std::string_view, size_t> byName; // qualified and unqualified names, the first one registered wins
+
+    // registers a symbol without a name yet, appends the marker for where its documentation starts to markers, and
+    // returns its id
+    size_t reserve(std::string& markers) {
+        symbols.emplace_back();
+        append_marker(markers, 'A', symbols.size() - 1);
+        return symbols.size() - 1;
+    }
+
+    // names symbol id scope::name, or just name without a scope
+    void name(size_t id, std::string_view scope, std::string_view name) {
+        Symbol& symbol = symbols[id];
+        symbol.name.clear();
+        if (!scope.empty()) {
+            symbol.name.append(scope);
+            symbol.name += "::";
+        }
+        symbol.unqualified = symbol.name.size();
+        symbol.name.append(name);
+    }
+
+    // registers a reference and returns its marker
+    std::string reference(std::string_view target, std::string_view text, std::string where) {
+        references.push_back({std::string(target), std::string(text.empty() ? target : text), std::move(where)});
+        return marker('R', references.size() - 1);
+    }
+
+    // replaces the markers in output: anchors for the symbols something links to, markdown links for the references
+    void link(std::string& output) {
+        if (symbols.empty() && references.empty()) {
+            return;
+        }
+        if (!references.empty()) {
+            byName.reserve(symbols.size() * 2);
+            for (size_t id = 0; id < symbols.size(); id++) {
+                std::string_view name = symbols[id].name;
+                if (name.empty()) {
+                    continue;
+                }
+                byName.emplace(name, id);
+                byName.emplace(name.substr(symbols[id].unqualified), id);
+            }
+        }
+        // resolve every reference, and give each symbol that is linked to an anchor id that is unique in the output
+        std::vector<size_t> targets(references.size(), std::string_view::npos);
+        std::vector<std::string> anchors(symbols.size());
+        std::unordered_map<std::string, size_t> anchorUses;
+        for (size_t i = 0; i < references.size(); i++) {
+            size_t id = resolve(references[i].target);
+            if (id == std::string_view::npos) {
+                std::cerr << references[i].where << ": Warning: @REF(" << references[i].target << ") is not a documented symbol\n";
+                continue;
+            }
+            targets[i] = id;
+            if (anchors[id].empty()) {
+                std::string anchor = slug(symbols[id].name);
+                size_t uses = anchorUses[anchor]++;
+                anchors[id] = uses ? anchor + "-" + std::to_string(uses + 1) : anchor;
+            }
+        }
+
+        std::string linked;
+        linked.reserve(output.size());
+        std::string anchorTags; // for the anchor markers read since the last text
+        const char* base = output.data();
+        const char* end = base + output.size();
+        size_t copied = 0;
+        for (const char* p = base; (p = simd::find_any(p, end, markerBegin)) != end; ) {
+            size_t at = p - base;
+            size_t close = output.find(markerEnd, at);
+            char kind = at + 1 < output.size() ? output[at + 1] : '\0';
+            if (close == std::string::npos || (kind != 'A' && kind != 'R')) {
+                // not one of ours
+                p++;
+                continue;
+            }
+            size_t id = std::strtoull(output.c_str() + at + 2, nullptr, 10);
+            linked.append(output, copied, at - copied);
+            copied = close + 1;
+            if (kind == 'A') {
+                if (id < anchors.size() && !anchors[id].empty()) {
+                    anchorTags += "<a id=\"" + anchors[id] + "\"></a>";
+                }
+                // anchor markers in a row go to the same place, in front of the text after the last one
+                bool more = copied + 1 < output.size() && output[copied] == markerBegin && output[copied + 1] == 'A';
+                if (!more && !anchorTags.empty()) {
+                    copied = place_anchors(linked, anchorTags, output, copied);
+                    anchorTags.clear();
+                }
+            } else if (kind == 'R' && id < references.size()) {
+                const Reference& ref = references[id];
+                if (targets[id] == std::string_view::npos) {
+                    linked += ref.text;
+                } else {
+                    linked += "[" + ref.text + "](#" + anchors[targets[id]] + ")";
+                }
+            }
+            p = base + copied;
+        }
+        linked.append(output, copied, std::string::npos);
+        output = std::move(linked);
+    }
+
+private:
+    static std::string marker(char kind, size_t id) {
+        std::string out;
+        append_marker(out, kind, id);
+        return out;
+    }
+
+    static void append_marker(std::string& out, char kind, size_t id) {
+        char digits[24];
+        char* end = std::to_chars(digits, digits + sizeof(digits), id).ptr;
+        out += markerBegin;
+        out += kind;
+        out.append(digits, end);
+        out += markerEnd;
+    }
+
+    // appends the anchor tags of the markers in front of the text at pos to linked, and returns where the text goes on
+    // from. Anything in front of a heading's #s, a list bullet or number or a quote's '>' would stop it from being one,
+    // so the tags go after those; a code block, table or HTML block needs its line to itself, so the tags become a
+    // paragraph of their own before it.
+    static size_t place_anchors(std::string& linked, const std::string& tags, const std::string& output, size_t pos) {
+        size_t indent = 0;
+        while (indent < linked.size() && linked[linked.size() - 1 - indent] == ' ') indent++;
+        size_t lineStart = linked.size() - indent;
+        if ((lineStart > 0 && linked[lineStart-1] != '\n') || pos >= output.size()) {
+            linked += tags;
+            return pos;
+        }
+        // a blank line (or nothing) before it, so this line starts a block rather than going on with a paragraph
+        size_t before = lineStart > 0 ? lineStart - 1 : 0;
+        while (before > 0 && (linked[before-1] == ' ' || linked[before-1] == '\t')) before--;
+        bool blockStart = lineStart == 0 || before == 0 || linked[before-1] == '\n';
+        bool fence = output.compare(pos, 3, "```") == 0 || output.compare(pos, 3, "~~~") == 0;
+        if (fence || (blockStart && (indent >= 4 || output[pos] == '|' || output[pos] == '<'))) {
+            linked.insert(lineStart, (blockStart ? "" : "\n") + tags + "\n\n");
+            return pos;
+        }
+        size_t prefix = block_prefix(output, pos);
+        linked.append(output, pos, prefix - pos);
+        linked += tags;
+        return prefix;
+    }
+
+    // where the text of a line starting at pos begins, after a heading's #s, a list bullet or number, or a quote's '>'
+    static size_t block_prefix(const std::string& output, size_t pos) {
+        size_t end = pos;
+        char c = output[pos];
+        if (c == '#') {
+            while (end < output.size() && output[end] == '#') end++;
+        } else if (std::isdigit((unsigned char) c)) {
+            while (end < output.size() && std::isdigit((unsigned char) output[end])) end++;
+            if (end == output.size() || (output[end] != '.' && output[end] != ')')) {
+                return pos;
+            }
+            end++;
+        } else if (c == '-' || c == '*' || c == '+' || c == '>') {
+            end++;
+        } else {
+            return pos;
+        }
+        return end < output.size() && output[end] == ' ' ? end + 1 : pos;
+    }
+
+    // the symbol a reference names: an exact match, or a symbol whose class wasn't known with the same name
+    size_t resolve(std::string_view target) const {
+        if (auto it = byName.find(target); it != byName.end()) {
+            return it->second;
+        }
+        size_t scope = target.rfind("::");
+        if (scope != std::string_view::npos) {
+            auto it = byName.find(target.substr(scope + 2));
+            if (it != byName.end() && symbols[it->second].unqualified == 0) {
+                return it->second;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    // an HTML id for a name: letters, digits and '_' kept, anything else a single '-'
+    static std::string slug(std::string_view name) {
+        std::string id;
+        for (char c : name) {
+            bool word = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+            if (word) {
+                id += c;
+            } else if (!id.empty() && id.back() != '-') {
+                id += '-';
+            }
+        }
+        while (!id.empty() && id.back() == '-') {
+            id.pop_back();
+        }
+        return id.empty() ? "symbol" : id;
+    }
+};
@@ -12,4 +12,55 @@ long long int sampleFunction(int a, float b) {
 test stuff and things
  */
 
-// another comment
\ No newline at end of file
+// another comment
+/*@DOC
+@SECTION(Functions)
+@FUNCTION
+The first argument is `@FUNC_ARG(0)` and the second `@FUNC_ARG(1)`, the `<` is a less-than
+*/
+bool inRange(bool x = lo<hi, int y = 2);
+
+/*@DOC
+@SECTION(Functions)
+@FUNCTION
+A function returning a function pointer
+*/
+void (*signalHandler(int sig, void (*handler)(int)))(int);
+
+/*@DOC
+@SECTION(Macros)
+`@NEXT_MACRO` and
+*/
+#define PLAIN_VALUE 3
+
+/*@DOC
+@SECTION(Macros)
+`@NEXT_MACRO`
+*/
+#define TWICE(x) ((x) * 2)
+
+/*@DOC
+@SECTION(Functions)
+```cpp
+@S_NEXT_DECL
+```
+A function documented without a heading, which uses @REF(sampleFunction) and @REF(clampValue, itself)
+*/
+int clampValue(int value, int low, int high);
+
+/*@DOC
+@SECTION(Classes)
+### `@CLASS_NAME`
+@CLASS_MEMBERS
+*/
+class Counter : public Base {
+public:
+    using Base::reset;
+    using value_type = int;
+    friend class CounterTest;
+    friend bool operator==(const Counter& a, const Counter& b) { return a.count == b.count; }
+    Counter(int start) : count(start) {}
+    int next() { return ++count; }
+private:
+    int count;
+};
@@ -0,0 +1,315 @@
+/**
+ * Compares a docgen_bench --json run against a checked-in baseline, and fails when a tracked metric regresses.
+ * The baseline is a docgen_bench --json file with two extra keys:
+ *   "threshold_percent": how much worse a tracked metric may get before it counts as a regression
+ *   "tracked": [{"benchmark": "<name>", "metric": "<bytes_per_second | items_per_second | ns_per_op | allocs_per_op>"}]
+ * Metrics ending in _per_second are better when higher, the others are better when lower.
+ * Usage: docgen_bench_compare <baseline.json> <current.json> [--threshold <percent>] [--update]
+ *   --update rewrites the baseline with the current numbers, keeping its tracked metrics and threshold.
+ * Exits with 1 when a tracked metric regressed or is missing, 2 on bad input.
+ */
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// just enough JSON to read docgen_bench output
+struct JsonValue {
+    enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    const JsonValue* get(const std::string& key) const {
+        for (const auto& [k, v] : object) {
+            if (k == key) return &v;
+        }
+        return nullptr;
+    }
+};
+
+struct JsonParser {
+    const std::string& src;
+    size_t pos = 0;
+    std::string error;
+
+    explicit JsonParser(const std::string& src) : src(src) {}
+
+    void skip_whitespace() {
+        while (pos < src.size() && std::isspace((unsigned char) src[pos])) pos++;
+    }
+
+    bool fail(const std::string& message) {
+        if (error.empty()) error = message + " at offset " + std::to_string(pos);
+        return false;
+    }
+
+    bool parse_string(std::string& out) {
+        if (src[pos] != '"') return fail("expected string");
+        pos++;
+        while (pos < src.size() && src[pos] != '"') {
+            if (src[pos] == '\\' && pos + 1 < src.size()) {
+                pos++;
+                switch (src[pos]) {
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case 'r': out += '\r'; break;
+                    case 'u': out += '?'; pos += 4; break;
+                    default: out += src[pos];
+                }
+                pos++;
+            } else {
+                out += src[pos++];
+            }
+        }
+        if (pos >= src.size()) return fail("unterminated string");
+        pos++;
+        return true;
+    }
+
+    bool parse(JsonValue& value) {
+        skip_whitespace();
+        if (pos >= src.size()) return fail("unexpected end");
+        char c = src[pos];
+        if (c == '{') {
+            value.type = JsonValue::Object;
+            pos++;
+            skip_whitespace();
+            if (pos < src.size() && src[pos] == '}') {
+                pos++;
+                return true;
+            }
+            while (true) {
+                skip_whitespace();
+                std::string key;
+                if (!parse_string(key)) return false;
+                skip_whitespace();
+                if (pos >= src.size() || src[pos] != ':') return fail("expected ':'");
+                pos++;
+                JsonValue child;
+                if (!parse(child)) return false;
+                value.object.emplace_back(std::move(key), std::move(child));
+                skip_whitespace();
+                if (pos < src.size() && src[pos] == ',') {
+                    pos++;
+                } else if (pos < src.size() && src[pos] == '}') {
+                    pos++;
+                    return true;
+                } else {
+                    return fail("expected ',' or '}'");
+                }
+            }
+        } else if (c == '[') {
+            value.type = JsonValue::Array;
+            pos++;
+            skip_whitespace();
+            if (pos < src.size() && src[pos] == ']') {
+                pos++;
+                return true;
+            }
+            while (true) {
+                JsonValue child;
+                if (!parse(child)) return false;
+                value.array.push_back(std::move(child));
+                skip_whitespace();
+                if (pos < src.size() && src[pos] == ',') {
+                    pos++;
+                } else if (pos < src.size() && src[pos] == ']') {
+                    pos++;
+                    return true;
+                } else {
+                    return fail("expected ',' or ']'");
+                }
+            }
+        } else if (c == '"') {
+            value.type = JsonValue::String;
+            return parse_string(value.string);
+        } else if (src.compare(pos, 4, "true") == 0 || src.compare(pos, 5, "false") == 0) {
+            value.type = JsonValue::Bool;
+            value.boolean = c == 't';
+            pos += value.boolean ? 4 : 5;
+            return true;
+        } else if (src.compare(pos, 4, "null") == 0) {
+            pos += 4;
+            return true;
+        } else {
+            value.type = JsonValue::Number;
+            char* end = nullptr;
+            value.number = std::strtod(src.c_str() + pos, &end);
+            if (end == src.c_str() + pos) return fail("unexpected character");
+            pos = end - src.c_str();
+            return true;
+        }
+    }
+};
+
+bool load_json(const std::string& path, JsonValue& value) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Error: Could not open " << path << '\n';
+        return false;
+    }
+    std::string src((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    JsonParser parser(src);
+    if (!parser.parse(value) || value.type != JsonValue::Object) {
+        std::cerr << "Error: " << path << " is not a benchmark file: " << parser.error << '\n';
+        return false;
+    }
+    return true;
+}
+
+// benchmark name -> metric name -> value
+using Metrics = std::map<std::string, std::map<std::string, double>>;
+
+Metrics benchmark_metrics(const JsonValue& root) {
+    Metrics metrics;
+    const JsonValue* benchmarks = root.get("benchmarks");
+    if (!benchmarks) return metrics;
+    for (const JsonValue& b : benchmarks->array) {
+        const JsonValue* name = b.get("name");
+        if (!name) continue;
+        for (const auto& [key, value] : b.object) {
+            if (value.type == JsonValue::Number) {
+                metrics[name->string][key] = value.number;
+            }
+        }
+    }
+    return metrics;
+}
+
+bool higher_is_better(const std::string& metric) {
+    const std::string suffix = "_per_second";
+    return metric.size() >= suffix.size() && metric.compare(metric.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// the current run, with the tracked metrics and threshold of the baseline
+void write_baseline(const std::string& path, const JsonValue& current, const JsonValue& baseline, double threshold) {
+    std::ofstream out(path);
+    out << "{\n  \"threshold_percent\": " << threshold << ",\n  \"tracked\": [\n";
+    const JsonValue* tracked = baseline.get("tracked");
+    size_t n = tracked ? tracked->array.size() : 0;
+    for (size_t i = 0; i < n; i++) {
+        const JsonValue& t = tracked->array[i];
+        out << "    {\"benchmark\": \"" << t.get("benchmark")->string << "\", \"metric\": \"" << t.get("metric")->string
+            << "\"}" << (i + 1 < n ? ",\n" : "\n");
+    }
+    out << "  ],\n  \"benchmarks\": [\n";
+    out << std::setprecision(3) << std::fixed;
+    const JsonValue* benchmarks = current.get("benchmarks");
+    size_t m = benchmarks ? benchmarks->array.size() : 0;
+    for (size_t i = 0; i < m; i++) {
+        const JsonValue& b = benchmarks->array[i];
+        out << "    {";
+        for (size_t k = 0; k < b.object.size(); k++) {
+            const auto& [key, value] = b.object[k];
+            out << (k ? ", " : "") << '"' << key << "\": ";
+            if (value.type == JsonValue::String) {
+                out << '"' << value.string << '"';
+            } else if (value.number == std::floor(value.number)) {
+                out << (long long) value.number;
+            } else {
+                out << value.number;
+            }
+        }
+        out << "}" << (i + 1 < m ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> files;
+    double threshold = -1;
+    bool update = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::stod(argv[++i]);
+        } else if (arg == "--update") {
+            update = true;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.size() != 2) {
+        std::cerr << "Usage: docgen_bench_compare <baseline.json> <current.json> [--threshold <percent>] [--update]\n";
+        return 2;
+    }
+
+    JsonValue baseline, current;
+    if (!load_json(files[0], baseline) || !load_json(files[1], current)) {
+        return 2;
+    }
+    if (threshold < 0) {
+        const JsonValue* t = baseline.get("threshold_percent");
+        threshold = t ? t->number : 10;
+    }
+    if (update) {
+        write_baseline(files[0], current, baseline, threshold);
+        std::cout << "Updated " << files[0] << '\n';
+        return 0;
+    }
+
+    Metrics base = benchmark_metrics(baseline);
+    Metrics now = benchmark_metrics(current);
+    const JsonValue* tracked = baseline.get("tracked");
+    if (!tracked || tracked->array.empty()) {
+        std::cerr << "Error: " << files[0] << " has no tracked metrics\n";
+        return 2;
+    }
+
+    int regressions = 0;
+    std::cout << std::left << std::setw(48) << "benchmark" << std::setw(18) << "metric" << std::right
+              << std::setw(16) << "baseline" << std::setw(16) << "current" << std::setw(10) << "change" << '\n';
+    for (const JsonValue& t : tracked->array) {
+        const JsonValue* name = t.get("benchmark");
+        const JsonValue* metric = t.get("metric");
+        if (!name || !metric) {
+            std::cerr << "Error: tracked entries need \"benchmark\" and \"metric\"\n";
+            return 2;
+        }
+        std::cout << std::left << std::setw(48) << name->string << std::setw(18) << metric->string << std::right;
+        auto b = base.find(name->string);
+        auto c = now.find(name->string);
+        if (b == base.end() || !b->second.count(metric->string)) {
+            std::cout << "  not in baseline, skipped\n";
+            continue;
+        }
+        if (c == now.end() || !c->second.count(metric->string)) {
+            std::cout << "  MISSING from current run\n";
+            regressions++;
+            continue;
+        }
+        double before = b->second[metric->string];
+        double after = c->second[metric->string];
+        // positive means worse
+        double worse;
+        if (before == 0) {
+            worse = after == 0 ? 0 : (higher_is_better(metric->string) ? -100 : 100);
+        } else if (higher_is_better(metric->string)) {
+            worse = (before - after) * 100 / before;
+        } else {
+            worse = (after - before) * 100 / before;
+        }
+        if (std::fabs(worse) < 0.005) {
+            worse = 0;
+        }
+        bool regressed = worse > threshold;
+        std::cout << std::fixed << std::setprecision(2) << std::setw(16) << before << std::setw(16) << after
+                  << std::setw(9) << std::showpos << 0 - worse << std::noshowpos << '%'
+                  << (regressed ? "  REGRESSION" : "") << '\n';
+        if (regressed) regressions++;
+    }
+
+    if (regressions) {
+        std::cout << regressions << " tracked metric(s) regressed by more than " << threshold << "%\n";
+        return 1;
+    }
+    std::cout << "No regressions (threshold " << threshold << "%)\n";
+    return 0;
+}
@@ -0,0 +1,225 @@
+/**
+ * Writes a synthetic, reproducible source tree plus a matching .docgen, for scaling tests of docgen.
+ * The same options and seed always produce byte-identical output.
+ * Usage: docgen_corpus <output dir> [options]
+ *   --files <n>           number of source files (default 100)
+ *   --depth <n>           maximum directory depth below src/ (default 2)
+ *   --dir-fanout <n>      subdirectories per directory (default 4)
+ *   --file-size <bytes>   approximate size of each source file (default 8192)
+ *   --doc-density <0-1>   fraction of functions that get a @DOC comment (default 0.5)
+ *   --alias-ratio <0-1>   fraction of doc comments that use the FUNCTION alias instead of plain commands (default 0.5)
+ *   --plugin-ratio <0-1>  fraction of doc comments that call the GEN_CMD plugin command (default 0)
+ *   --sections <n>        number of sections the doc comments are spread over (default 4)
+ *   --seed <n>            random seed (default 1)
+ */
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct CorpusOptions {
+    fs::path outputDir;
+    size_t files = 100;
+    size_t depth = 2;
+    size_t dirFanout = 4;
+    size_t fileSize = 8192;
+    double docDensity = 0.5;
+    double aliasRatio = 0.5;
+    double pluginRatio = 0;
+    size_t sections = 4;
+    uint64_t seed = 1;
+};
+
+// splitmix64, so the output doesn't depend on the standard library's distributions
+struct Rng {
+    uint64_t state;
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    size_t below(size_t n) {
+        return n == 0 ? 0 : next() % n;
+    }
+
+    bool chance(double p) {
+        return (next() >> 11) * (1.0 / 9007199254740992.0) < p;
+    }
+};
+
+struct CorpusStats {
+    size_t files = 0;
+    size_t bytes = 0;
+    size_t functions = 0;
+    size_t docComments = 0;
+};
+
+static const char* types[] = {"int", "long long int", "float", "double", "std::string", "const char*", "bool", "size_t"};
+static const char* words[] = {"the", "value", "returns", "computes", "buffer", "index", "section", "parser", "input",
+                              "output", "given", "when", "fast", "path", "each", "item", "list", "table"};
+
+std::string random_type(Rng& rng) {
+    return types[rng.below(sizeof(types) / sizeof(types[0]))];
+}
+
+std::string random_sentence(Rng& rng) {
+    std::string s;
+    size_t n = 4 + rng.below(10);
+    for (size_t i = 0; i < n; i++) {
+        if (i) s += ' ';
+        s += words[rng.below(sizeof(words) / sizeof(words[0]))];
+    }
+    s[0] = (char) std::toupper(s[0]);
+    return s + ".";
+}
+
+std::string make_function(Rng& rng, const CorpusOptions& options, const std::string& name, CorpusStats& stats) {
+    std::string out;
+    stats.functions++;
+    if (rng.chance(options.docDensity)) {
+        stats.docComments++;
+        out += "/*@DOC\n@SECTION(Section" + std::to_string(rng.below(options.sections)) + ")\n";
+        if (rng.chance(options.aliasRatio)) {
+            out += "@FUNCTION\n";
+        } else {
+            out += "#### `@FUNC_NAME`\n```cpp\n@S_NEXT_DECL\n```\nArguments: `@S_FUNC_ARGS`, first is `@FUNC_ARG(0)`.\n";
+        }
+        size_t lines = 1 + rng.below(4);
+        for (size_t i = 0; i < lines; i++) {
+            out += random_sentence(rng) + '\n';
+        }
+        if (rng.chance(options.pluginRatio)) {
+            out += "@GEN_CMD(" + name + ")\n";
+        }
+        out += "*/\n";
+    } else if (rng.chance(0.5)) {
+        out += "// " + random_sentence(rng) + '\n';
+    }
+    size_t argc = 1 + rng.below(4);
+    out += random_type(rng) + " " + name + "(";
+    for (size_t i = 0; i < argc; i++) {
+        if (i) out += ", ";
+        out += random_type(rng) + " arg" + std::to_string(i);
+    }
+    out += ") {\n";
+    size_t body = 1 + rng.below(6);
+    for (size_t i = 0; i < body; i++) {
+        out += "    int local" + std::to_string(i) + " = " + std::to_string(rng.below(1000)) + ";";
+        if (rng.chance(0.3)) {
+            out += " // " + random_sentence(rng);
+        }
+        out += '\n';
+    }
+    out += "    return {};\n}\n\n";
+    return out;
+}
+
+std::string make_file(Rng& rng, const CorpusOptions& options, size_t fileIndex, CorpusStats& stats) {
+    std::string src = "/*\n * Generated file " + std::to_string(fileIndex) + "\n * " + random_sentence(rng) + "\n */\n";
+    src += "#include <string>\n\n";
+    size_t fn = 0;
+    while (src.size() < options.fileSize) {
+        src += make_function(rng, options, "f" + std::to_string(fileIndex) + "_" + std::to_string(fn++), stats);
+    }
+    return src;
+}
+
+std::string make_docgen(const CorpusOptions& options) {
+    std::string out = "@@NEW_ALIAS(FUNCTION,\n"
+                      "\"#### `@FUNC_NAME` returns `@S_FUNC_RET` with args `@S_FUNC_ARGS`:\n"
+                      "```cpp\n"
+                      "@S_NEXT_DECL\n"
+                      "@@```\")\n\n";
+    if (options.pluginRatio > 0) {
+        out += "@@NEW_COMMAND(GEN_CMD,\n"
+               "{\n"
+               "    return args.empty() ? std::string() : \"See also `\" + args[0] + \"`.\";\n"
+               "@@})\n\n";
+    }
+    // one PROCESS_SOURCES per directory level
+    std::string pattern = "src/";
+    for (size_t d = 0; d <= options.depth; d++) {
+        out += "@@PROCESS_SOURCES(" + pattern + "*.cpp)@@\n";
+        pattern += "*/";
+    }
+    out += "\n# Generated corpus\n\n";
+    for (size_t s = 0; s < options.sections; s++) {
+        out += "## Section " + std::to_string(s) + "\n\n@@INSERT_SECTION(Section" + std::to_string(s) + ")@@\n\n";
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    CorpusOptions options;
+    auto usage = []() {
+        std::cerr << "Usage: docgen_corpus <output dir> [--files n] [--depth n] [--dir-fanout n] [--file-size bytes]\n"
+                     "       [--doc-density 0-1] [--alias-ratio 0-1] [--plugin-ratio 0-1] [--sections n] [--seed n]\n";
+        return 1;
+    };
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            options.outputDir = arg;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return usage();
+        }
+        std::string value = argv[++i];
+        if (arg == "--files") {
+            options.files = std::stoul(value);
+        } else if (arg == "--depth") {
+            options.depth = std::stoul(value);
+        } else if (arg == "--dir-fanout") {
+            options.dirFanout = std::stoul(value);
+        } else if (arg == "--file-size") {
+            options.fileSize = std::stoul(value);
+        } else if (arg == "--doc-density") {
+            options.docDensity = std::stod(value);
+        } else if (arg == "--alias-ratio") {
+            options.aliasRatio = std::stod(value);
+        } else if (arg == "--plugin-ratio") {
+            options.pluginRatio = std::stod(value);
+        } else if (arg == "--sections") {
+            options.sections = std::stoul(value);
+        } else if (arg == "--seed") {
+            options.seed = std::stoull(value);
+        } else {
+            return usage();
+        }
+    }
+    if (options.outputDir.empty() || options.sections == 0 || options.dirFanout == 0) {
+        return usage();
+    }
+
+    Rng rng{options.seed};
+    CorpusStats stats;
+    fs::path srcDir = options.outputDir / "src";
+    fs::create_directories(srcDir);
+    for (size_t i = 0; i < options.files; i++) {
+        // pick a directory, anywhere from src/ itself down to the maximum depth
+        fs::path dir = srcDir;
+        size_t depth = rng.below(options.depth + 1);
+        for (size_t d = 0; d < depth; d++) {
+            dir /= "d" + std::to_string(rng.below(options.dirFanout));
+        }
+        fs::create_directories(dir);
+        std::string src = make_file(rng, options, i, stats);
+        std::ofstream(dir / ("file" + std::to_string(i) + ".cpp"), std::ios::binary) << src;
+        stats.files++;
+        stats.bytes += src.size();
+    }
+    std::ofstream(options.outputDir / ".docgen", std::ios::binary) << make_docgen(options);
+
+    std::cout << "Wrote " << stats.files << " files, " << stats.bytes << " bytes, " << stats.functions << " functions, "
+              << stats.docComments << " doc comments to " << options.outputDir << '\n';
+    return 0;
+}
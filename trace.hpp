@@ -0,0 +1,113 @@
+// Chrome trace event export for --trace, viewable in chrome://tracing or ui.perfetto.dev.
+// Every span is written as a complete ("X") event, with timestamps in microseconds since the start of the run.
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+inline std::string json_escape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if ((unsigned char) c < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
+}
+
+struct Tracer {
+    using clock = std::chrono::steady_clock;
+
+    struct Event {
+        std::string name;
+        const char* category;
+        double start;
+        double duration;
+        std::string args; // the inside of the args object, already JSON
+    };
+
+    clock::time_point startTime = clock::now();
+    std::vector<Event> events;
+
+    double now() const {
+        return std::chrono::duration<double, std::micro>(clock::now() - startTime).count();
+    }
+
+    bool write(const std::filesystem::path& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            return false;
+        }
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        for (size_t i = 0; i < events.size(); i++) {
+            const Event& e = events[i];
+            char times[96];
+            std::snprintf(times, sizeof(times), "\"ts\": %.3f, \"dur\": %.3f", e.start, e.duration);
+            out << "{\"name\": \"" << json_escape(e.name) << "\", \"cat\": \"" << e.category
+                << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, " << times << ", \"args\": {" << e.args << "}}"
+                << (i + 1 < events.size() ? ",\n" : "\n");
+        }
+        out << "]}\n";
+        return true;
+    }
+};
+
+// records a span for as long as it is in scope, does nothing when tracing is off
+struct TraceScope {
+    Tracer* tracer;
+    Tracer::Event event;
+
+    TraceScope(Tracer* tracer, const char* category, std::string_view name) : tracer(tracer) {
+        if (tracer) {
+            event.name = name;
+            event.category = category;
+            event.start = tracer->now();
+        }
+    }
+
+    ~TraceScope() {
+        stop();
+    }
+
+    // ends the span early
+    void stop() {
+        if (tracer) {
+            event.duration = tracer->now() - event.start;
+            tracer->events.push_back(std::move(event));
+        }
+        tracer = nullptr;
+    }
+
+    void arg(const char* key, size_t value) {
+        if (tracer) {
+            event.args += (event.args.empty() ? "\"" : ", \"") + std::string(key) + "\": " + std::to_string(value);
+        }
+    }
+
+    void arg(const char* key, const std::string& value) {
+        if (tracer) {
+            event.args += (event.args.empty() ? "\"" : ", \"") + std::string(key) + "\": \"" + json_escape(value) + "\"";
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};